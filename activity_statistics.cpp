@@ -0,0 +1,112 @@
+#include <fstream>
+#include <iomanip>
+#include "activity_statistics.h"
+
+static string format_ms(uint32_t ms)
+{
+    return format_timestamp((uint64_t)ms * NANOSECONDS_PER_MILLISECOND);
+}
+
+// Cancels and deletes per execution or trade; 0 when nothing traded.
+static double cancel_to_trade_ratio(const StockActivity &stock)
+{
+    uint64_t fills = stock.executions + stock.trades;
+    return (fills == 0) ? 0.0 : (double)(stock.cancels + stock.deletes) / fills;
+}
+
+bool ActivityStatistics::write_binary(const string &path) const
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+    {
+        return false;
+    }
+
+    ActivityStatisticsHeader header = {};
+    memcpy(header.magic, ACTIVITY_STATISTICS_MAGIC, sizeof(header.magic));
+    header.version = ACTIVITY_STATISTICS_VERSION;
+    header.stock_locates = (uint32_t)stocks.size();
+    header.heatmap_buckets = HEATMAP_BUCKETS;
+    header.rate_histogram_buckets = RATE_HISTOGRAM_BUCKETS;
+    header.heatmap_bucket_ns = HEATMAP_BUCKET_NS;
+    header.messages = messages;
+    header.peak_messages_per_ms = peak_messages_per_ms;
+    header.peak_ms = peak_ms;
+    memcpy(header.rate_histogram, rate_histogram, sizeof(rate_histogram));
+
+    file.write((const char *)&header, sizeof(header));
+    file.write((const char *)stocks.data(), stocks.size() * sizeof(StockActivity));
+    file.write((const char *)heatmap.data(), heatmap.size() * sizeof(uint32_t));
+    return (bool)file;
+}
+
+bool ActivityStatistics::write_json(const string &path, const InstrumentTable &i_table) const
+{
+    std::ofstream file(path);
+    if (!file)
+    {
+        return false;
+    }
+
+    file << "{\"messages\":" << messages
+         << ",\"peak_messages_per_ms\":" << peak_messages_per_ms
+         << ",\"peak_ms\":\"" << format_ms(peak_ms) << "\""
+         << ",\"heatmap_bucket_seconds\":" << HEATMAP_BUCKET_NS / 1000000000ull
+         << ",\"messages_per_ms_histogram\":[";
+    for (uint32_t bucket = 0; bucket < RATE_HISTOGRAM_BUCKETS; bucket++)
+    {
+        file << (bucket > 0 ? "," : "") << rate_histogram[bucket];
+    }
+    file << "],\"stocks\":[";
+
+    bool first = true;
+    for (size_t stock_locate = 0; stock_locate < stocks.size(); stock_locate++)
+    {
+        const StockActivity &stock = stocks[stock_locate];
+        if (stock.messages == 0)
+        {
+            continue;
+        }
+
+        // Symbols are space padded on the wire and never contain quotes.
+        const InstrumentTableEntry *entry = i_table.get_entry((uint16_t)stock_locate);
+        string symbol = (entry != nullptr) ? entry->stock.substr(0, entry->stock.find_last_not_of(' ') + 1) : "";
+
+        file << (first ? "" : ",") << "\n{\"stock_locate\":" << stock_locate
+             << ",\"symbol\":\"" << symbol << "\""
+             << ",\"messages\":" << stock.messages
+             << ",\"adds\":" << stock.adds
+             << ",\"cancels\":" << stock.cancels
+             << ",\"deletes\":" << stock.deletes
+             << ",\"replaces\":" << stock.replaces
+             << ",\"executions\":" << stock.executions
+             << ",\"trades\":" << stock.trades
+             << ",\"crosses\":" << stock.crosses
+             << ",\"executed_shares\":" << stock.executed_shares
+             << ",\"cancel_to_trade\":" << std::fixed << std::setprecision(3) << cancel_to_trade_ratio(stock) << std::defaultfloat
+             << ",\"peak_messages_per_ms\":" << stock.peak_messages_per_ms
+             << ",\"peak_ms\":\"" << format_ms(stock.peak_ms) << "\""
+             << ",\"heatmap\":[";
+        const uint32_t *row = &heatmap[stock_locate * HEATMAP_BUCKETS];
+        for (uint32_t bucket = 0; bucket < HEATMAP_BUCKETS; bucket++)
+        {
+            file << (bucket > 0 ? "," : "") << row[bucket];
+        }
+        file << "]}";
+        first = false;
+    }
+    file << "\n]}" << std::endl;
+    return (bool)file;
+}
+
+void ActivityStatistics::print_summary(std::ostream &os) const
+{
+    uint64_t active_stocks = 0;
+    for (const StockActivity &stock : stocks)
+    {
+        active_stocks += (stock.messages > 0);
+    }
+
+    os << "Activity: " << std::dec << messages << " messages over " << active_stocks << " stocks, peak "
+       << peak_messages_per_ms << " messages/ms at " << format_ms(peak_ms) << std::endl;
+}
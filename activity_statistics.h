@@ -0,0 +1,190 @@
+#ifndef ACTIVITY_STATISTICS_H
+#define ACTIVITY_STATISTICS_H
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "helper.h"
+#include "instrument_table.h"
+using namespace std;
+
+constexpr uint64_t NANOSECONDS_PER_MILLISECOND = 1000000ull;
+// The activity heatmap splits the day into 15 minute buckets per stock.
+constexpr uint64_t HEATMAP_BUCKET_NS = 15 * 60 * 1000000000ull;
+constexpr uint32_t HEATMAP_BUCKETS = 96;
+// Histogram of messages per millisecond in powers of two: bucket i counts the
+// milliseconds with [2^(i-1), 2^i) messages, the last bucket everything above.
+constexpr uint32_t RATE_HISTOGRAM_BUCKETS = 20;
+
+constexpr char ACTIVITY_STATISTICS_MAGIC[8] = {'I', 'T', 'C', 'H', 'S', 'T', 'A', 'T'};
+constexpr uint32_t ACTIVITY_STATISTICS_VERSION = 1;
+
+// Counters for one stock_locate. Plain data so the array can be written as is.
+struct StockActivity
+{
+    uint64_t messages;
+    uint64_t adds;
+    uint64_t cancels;
+    uint64_t deletes;
+    uint64_t replaces;
+    uint64_t executions;
+    uint64_t trades;
+    uint64_t crosses;
+    uint64_t executed_shares;
+    uint32_t peak_messages_per_ms;
+    // Milliseconds since midnight of the busiest millisecond.
+    uint32_t peak_ms;
+    uint32_t current_ms;
+    uint32_t current_ms_messages;
+};
+
+// Layout of the binary summary: this header, stock_locates StockActivity records,
+// then stock_locates * heatmap_buckets uint32_t message counts, stock-major.
+struct ActivityStatisticsHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t stock_locates;
+    uint32_t heatmap_buckets;
+    uint32_t rate_histogram_buckets;
+    uint64_t heatmap_bucket_ns;
+    uint64_t messages;
+    uint32_t peak_messages_per_ms;
+    uint32_t peak_ms;
+    uint64_t rate_histogram[RATE_HISTOGRAM_BUCKETS];
+};
+
+// Per-stock message counts and rates built in the replay pass, replacing CSV
+// dumps and offline post-processing. Each message costs a few increments in
+// the stock's record and heatmap row; the millisecond windows only do more
+// work when the millisecond changes.
+class ActivityStatistics
+{
+public:
+    // type is the message type byte; shares are the executed or traded shares, 0 otherwise.
+    void record(char type, uint16_t stock_locate, uint64_t timestamp, uint32_t shares)
+    {
+        uint32_t ms = (uint32_t)(timestamp / NANOSECONDS_PER_MILLISECOND);
+        if (ms != current_ms)
+        {
+            roll_millisecond(ms);
+        }
+        current_ms_messages++;
+        messages++;
+
+        if (stock_locate == 0)
+        {
+            return;
+        }
+        if (stock_locate >= stocks.size())
+        {
+            grow(stock_locate);
+        }
+
+        StockActivity &stock = stocks[stock_locate];
+        stock.messages++;
+        if (stock.current_ms != ms)
+        {
+            stock.current_ms = ms;
+            stock.current_ms_messages = 0;
+        }
+        if (++stock.current_ms_messages > stock.peak_messages_per_ms)
+        {
+            stock.peak_messages_per_ms = stock.current_ms_messages;
+            stock.peak_ms = ms;
+        }
+
+        uint64_t bucket = timestamp / HEATMAP_BUCKET_NS;
+        heatmap[(size_t)stock_locate * HEATMAP_BUCKETS + (bucket < HEATMAP_BUCKETS ? bucket : HEATMAP_BUCKETS - 1)]++;
+
+        switch (type)
+        {
+        case 'A':
+        case 'F':
+            stock.adds++;
+            break;
+        case 'X':
+            stock.cancels++;
+            break;
+        case 'D':
+            stock.deletes++;
+            break;
+        case 'U':
+            stock.replaces++;
+            break;
+        case 'E':
+        case 'C':
+            stock.executions++;
+            stock.executed_shares += shares;
+            break;
+        case 'P':
+            stock.trades++;
+            stock.executed_shares += shares;
+            break;
+        case 'Q':
+            stock.crosses++;
+            stock.executed_shares += shares;
+            break;
+        }
+    }
+
+    // Closes the last millisecond window; call once the replay is done.
+    void finish()
+    {
+        roll_millisecond(current_ms);
+    }
+
+    const StockActivity *get_stock(uint16_t stock_locate) const
+    {
+        return (stock_locate < stocks.size()) ? &stocks[stock_locate] : nullptr;
+    }
+
+    uint32_t get_peak_messages_per_ms() const
+    {
+        return peak_messages_per_ms;
+    }
+
+    // Both return false if the file could not be written.
+    bool write_binary(const string &path) const;
+    bool write_json(const string &path, const InstrumentTable &i_table) const;
+
+    void print_summary(std::ostream &os = std::cout) const;
+
+private:
+    vector<StockActivity> stocks;
+    vector<uint32_t> heatmap;
+    uint64_t messages = 0;
+    uint32_t current_ms = 0;
+    uint32_t current_ms_messages = 0;
+    uint32_t peak_messages_per_ms = 0;
+    uint32_t peak_ms = 0;
+    uint64_t rate_histogram[RATE_HISTOGRAM_BUCKETS] = {};
+
+    void roll_millisecond(uint32_t ms)
+    {
+        if (current_ms_messages > 0)
+        {
+            uint32_t bucket = 32 - __builtin_clz(current_ms_messages);
+            rate_histogram[bucket < RATE_HISTOGRAM_BUCKETS ? bucket : RATE_HISTOGRAM_BUCKETS - 1]++;
+            if (current_ms_messages > peak_messages_per_ms)
+            {
+                peak_messages_per_ms = current_ms_messages;
+                peak_ms = current_ms;
+            }
+        }
+        current_ms = ms;
+        current_ms_messages = 0;
+    }
+
+    void grow(uint16_t stock_locate)
+    {
+        // Locates are handed out densely from 1, so this only happens a few times.
+        size_t size = std::min<size_t>(std::max<size_t>(stock_locate + 1, stocks.size() * 2), UINT16_MAX + 1);
+        stocks.resize(size, StockActivity{});
+        heatmap.resize(size * HEATMAP_BUCKETS, 0);
+    }
+};
+
+#endif // ACTIVITY_STATISTICS_H
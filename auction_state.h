@@ -0,0 +1,160 @@
+#ifndef AUCTION_STATE_H
+#define AUCTION_STATE_H
+
+#include <iostream>
+#include <vector>
+#include "helper.h"
+using namespace std;
+
+struct Imbalance
+{
+    uint64_t timestamp;
+    uint64_t paired_shares;
+    uint64_t imbalance_shares;
+    char imbalance_direction;
+    char cross_type;
+    char price_variation_indicator;
+    Price far_price;
+    Price near_price;
+    Price current_reference_price;
+};
+
+struct AuctionCollar
+{
+    uint64_t timestamp;
+    Price reference_price;
+    Price upper_price;
+    Price lower_price;
+    uint32_t extension;
+};
+
+struct IPOQuotingPeriod
+{
+    uint64_t timestamp;
+    uint32_t release_time;
+    char release_qualifier;
+    Price price;
+};
+
+struct AuctionState
+{
+    Imbalance imbalance;
+    AuctionCollar collar;
+    IPOQuotingPeriod ipo;
+};
+
+struct MarketWideCircuitBreaker
+{
+    uint64_t level_1;
+    uint64_t level_2;
+    uint64_t level_3;
+    char breached_level;
+};
+
+// Latest auction related state per stock_locate, kept in a flat array so that a
+// lookup is a single index rather than a hash probe. A timestamp of 0 means the
+// corresponding message has not been received for that stock yet.
+class AuctionStateTable
+{
+private:
+    vector<AuctionState> auction_states;
+    MarketWideCircuitBreaker circuit_breaker = {};
+
+    AuctionState &state_for(uint16_t stock_locate)
+    {
+        if (stock_locate >= auction_states.size())
+        {
+            auction_states.resize(stock_locate + 1, AuctionState{});
+        }
+        return auction_states[stock_locate];
+    }
+
+public:
+    AuctionStateTable()
+    {
+        auction_states.reserve(UINT16_MAX + 1);
+    }
+
+    void add_noii_message(const NOIIMessage &message)
+    {
+        Imbalance &imbalance = state_for(message.header.stock_locate).imbalance;
+        imbalance.timestamp = message.header.timestamp;
+        imbalance.paired_shares = message.paired_shares;
+        imbalance.imbalance_shares = message.imbalance_shares;
+        imbalance.imbalance_direction = message.imbalance_direction;
+        imbalance.cross_type = message.cross_type;
+        imbalance.price_variation_indicator = message.price_variation_indicator;
+        imbalance.far_price = message.far_price;
+        imbalance.near_price = message.near_price;
+        imbalance.current_reference_price = message.current_reference_price;
+    }
+
+    void add_luld_auction_collar_message(const LULDAuctionCollarMessage &message)
+    {
+        AuctionCollar &collar = state_for(message.header.stock_locate).collar;
+        collar.timestamp = message.header.timestamp;
+        collar.reference_price = message.auction_collar_reference_price;
+        collar.upper_price = message.upper_auction_collar_price;
+        collar.lower_price = message.lower_auction_collar_price;
+        collar.extension = message.auction_collar_extension;
+    }
+
+    void add_ipo_quoting_period_message(const IPOQuotingPeriodMessage &message)
+    {
+        IPOQuotingPeriod &ipo = state_for(message.header.stock_locate).ipo;
+        ipo.timestamp = message.header.timestamp;
+        ipo.release_time = message.ipo_quotation_release_time;
+        ipo.release_qualifier = message.ipo_quotation_release_qualifier;
+        ipo.price = message.ipo_price;
+    }
+
+    void add_mwcb_decline_message(const MWCBDeclineMessage &message)
+    {
+        circuit_breaker.level_1 = message.level_1;
+        circuit_breaker.level_2 = message.level_2;
+        circuit_breaker.level_3 = message.level_3;
+    }
+
+    void add_mwcb_status_message(const MWCBStatusMessage &message)
+    {
+        circuit_breaker.breached_level = message.breached_level;
+    }
+
+    const AuctionState &get_auction_state(uint16_t stock_locate) const
+    {
+        static const AuctionState empty_state = {};
+        return (stock_locate < auction_states.size()) ? auction_states[stock_locate] : empty_state;
+    }
+
+    const Imbalance &get_latest_imbalance(uint16_t stock_locate) const
+    {
+        return get_auction_state(stock_locate).imbalance;
+    }
+
+    const MarketWideCircuitBreaker &get_circuit_breaker() const
+    {
+        return circuit_breaker;
+    }
+
+    void print_auction_state(uint16_t stock_locate) const
+    {
+        const AuctionState &state = get_auction_state(stock_locate);
+
+        std::cout << "Paired Shares,Imbalance Shares,Imbalance Direction,Far Price,Near Price,Reference Price,"
+                  << "Collar Reference Price,Upper Collar Price,Lower Collar Price,IPO Release Time,IPO Price" << std::endl;
+
+        std::cout << std::dec << state.imbalance.paired_shares << ","
+                  << state.imbalance.imbalance_shares << ","
+                  << state.imbalance.imbalance_direction << ","
+                  << state.imbalance.far_price << ","
+                  << state.imbalance.near_price << ","
+                  << state.imbalance.current_reference_price << ","
+                  << state.collar.reference_price << ","
+                  << state.collar.upper_price << ","
+                  << state.collar.lower_price << ","
+                  << state.ipo.release_time << ","
+                  << state.ipo.price << std::endl;
+    }
+};
+
+#endif // AUCTION_STATE_H
@@ -0,0 +1,109 @@
+#include <iostream>
+#include <chrono>
+#include <filesystem>
+#include <sstream>
+#include <thread>
+#include <unistd.h>
+#include "batch_replay.h"
+
+void print_usage(const char *program)
+{
+    std::cerr << "Usage: " << program << " [-D] [-H] [-j threads] [-m memory_budget_mb] [-o output_dir] [-s SYM1,SYM2,...] capture..." << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    BatchReplayOptions options = {
+        .threads = std::max(1u, std::thread::hardware_concurrency()),
+        .memory_budget = 16ull << 30,
+        .output_dir = "",
+        .symbols = {},
+        .read_mode = ReadMode::BUFFERED,
+        .window = {}};
+
+    MemoryPolicy memory_policy = {.huge_pages = false, .gigantic_pages = false, .numa_node = -1};
+
+    int option;
+    while ((option = getopt(argc, argv, "DHj:m:o:s:")) != -1)
+    {
+        switch (option)
+        {
+        case 'D':
+            options.read_mode = ReadMode::DIRECT;
+            break;
+        case 'H':
+            memory_policy.huge_pages = true;
+            break;
+        case 'j':
+        {
+            uint64_t threads;
+            if (!parse_unsigned(optarg, 4096, threads))
+            {
+                print_usage(argv[0]);
+                return 1;
+            }
+            options.threads = threads;
+            break;
+        }
+        case 'm':
+            // Megabytes; bounded so the shift to bytes cannot overflow.
+            if (!parse_unsigned(optarg, UINT64_MAX >> 20, options.memory_budget))
+            {
+                print_usage(argv[0]);
+                return 1;
+            }
+            options.memory_budget <<= 20;
+            break;
+        case 'o':
+            options.output_dir = optarg;
+            break;
+        case 's':
+        {
+            std::stringstream symbols(optarg);
+            string symbol;
+            while (std::getline(symbols, symbol, ','))
+            {
+                options.symbols.push_back(symbol);
+            }
+            break;
+        }
+        default:
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    vector<string> paths = expand_capture_paths(vector<string>(argv + optind, argv + argc));
+    if (paths.empty())
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    if (!options.output_dir.empty())
+    {
+        std::error_code error;
+        std::filesystem::create_directories(options.output_dir, error);
+        if (error)
+        {
+            std::cerr << "Could not create " << options.output_dir << ": " << error.message() << std::endl;
+            return 1;
+        }
+    }
+
+    set_memory_policy(memory_policy);
+    BatchReplay batch(options);
+    auto start = std::chrono::steady_clock::now();
+    vector<BatchReplayResult> results = batch.run(paths);
+    double wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    batch.print_throughput_report(results, wall_seconds);
+    for (const BatchReplayResult &result : results)
+    {
+        if (!result.opened || !result.summary_written || result.counters.read_errors > 0)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
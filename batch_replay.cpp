@@ -0,0 +1,195 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <glob.h>
+#include <sys/stat.h>
+#include "batch_replay.h"
+#include "feed_reader.h"
+
+vector<string> expand_capture_paths(const vector<string> &patterns)
+{
+    vector<string> paths;
+    for (const string &pattern : patterns)
+    {
+        glob_t matches;
+        if (glob(pattern.c_str(), 0, nullptr, &matches) == 0)
+        {
+            for (size_t i = 0; i < matches.gl_pathc; i++)
+            {
+                paths.push_back(matches.gl_pathv[i]);
+            }
+        }
+        else
+        {
+            paths.push_back(pattern);
+        }
+        globfree(&matches);
+    }
+    return paths;
+}
+
+static bool is_compressed(const string &path)
+{
+    auto ends_with = [&path](const string &suffix)
+    {
+        return path.size() >= suffix.size() && path.compare(path.size() - suffix.size(), suffix.size(), suffix) == 0;
+    };
+    return ends_with(".gz") || ends_with(".zst") || ends_with(".zstd");
+}
+
+uint64_t estimate_replay_memory(const string &path)
+{
+    struct stat file_stat;
+    uint64_t file_size = (stat(path.c_str(), &file_stat) == 0) ? file_stat.st_size : 0;
+    uint64_t feed_size = is_compressed(path) ? file_size * 4 : file_size;
+
+    // A full day peaks at a few million live orders out of several GB of feed.
+    uint64_t book_size = feed_size / 8;
+    return FeedReader::DEFAULT_BUFFER_SIZE * FeedReader::DEFAULT_BUFFER_COUNT + book_size;
+}
+
+// Blocks replays from starting while the memory already promised to running ones
+// would push the total over the budget. A replay larger than the whole budget is
+// still admitted once nothing else is running.
+class MemoryBudget
+{
+public:
+    explicit MemoryBudget(uint64_t limit) : limit(limit) {}
+
+    void acquire(uint64_t bytes)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        released.wait(lock, [this, bytes]
+                      { return in_use == 0 || in_use + bytes <= limit; });
+        in_use += bytes;
+    }
+
+    void release(uint64_t bytes)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            in_use -= bytes;
+        }
+        released.notify_all();
+    }
+
+private:
+    uint64_t limit;
+    uint64_t in_use = 0;
+    std::mutex mutex;
+    std::condition_variable released;
+};
+
+vector<BatchReplayResult> BatchReplay::run(const vector<string> &paths)
+{
+    vector<BatchReplayResult> results(paths.size());
+    MemoryBudget budget(options.memory_budget);
+    std::atomic<size_t> next_path{0};
+
+    auto worker = [&]()
+    {
+        size_t index;
+        while ((index = next_path.fetch_add(1)) < paths.size())
+        {
+            uint64_t estimate = estimate_replay_memory(paths[index]);
+            budget.acquire(estimate);
+
+            auto start = std::chrono::steady_clock::now();
+            auto replay = std::make_unique<Replay>();
+            replay->read_mode = options.read_mode;
+            replay->window = options.window;
+            replay->venue = venue_from_path(paths[index]);
+            replay->consolidated_bbo = options.consolidated_bbo;
+            for (const string &symbol : options.symbols)
+            {
+                replay->symbol_filter.add_symbol(symbol);
+            }
+            BatchReplayResult &result = results[index];
+            result.path = paths[index];
+            result.venue = replay->venue;
+            result.opened = replay->run(paths[index]);
+            result.counters = replay->counters;
+            result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            result.summary_written = !result.opened || write_day_summary(result);
+            replay.reset();
+            budget.release(estimate);
+        }
+    };
+
+    size_t thread_count = std::max((size_t)1, std::min(options.threads, paths.size()));
+    vector<std::thread> threads;
+    for (size_t i = 0; i < thread_count; i++)
+    {
+        threads.emplace_back(worker);
+    }
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+    return results;
+}
+
+bool BatchReplay::write_day_summary(const BatchReplayResult &result) const
+{
+    if (options.output_dir.empty())
+    {
+        return true;
+    }
+
+    string name = result.path.substr(result.path.find_last_of('/') + 1);
+    std::ofstream summary(options.output_dir + "/" + name + ".summary");
+    if (!summary)
+    {
+        return false;
+    }
+    summary << "File: " << result.path << std::endl;
+    print_replay_counters(result.counters, summary);
+    summary << "Seconds: " << result.seconds << std::endl;
+    summary.close();
+    return (bool)summary;
+}
+
+void BatchReplay::print_throughput_report(const vector<BatchReplayResult> &results, double wall_seconds, std::ostream &os) const
+{
+    uint64_t total_frames = 0;
+    uint64_t total_bytes = 0;
+
+    os << "File,Messages,Bytes,Seconds,Messages/s" << std::endl;
+    for (const BatchReplayResult &result : results)
+    {
+        if (!result.opened)
+        {
+            os << result.path << ",failed to open" << std::endl;
+            continue;
+        }
+        if (result.counters.read_errors > 0)
+        {
+            os << result.path << ",stopped on a read error" << std::endl;
+        }
+        if (!result.summary_written)
+        {
+            os << result.path << ",failed to write summary to " << options.output_dir << std::endl;
+        }
+
+        total_frames += result.counters.frames;
+        total_bytes += result.counters.bytes;
+        os << result.path << ","
+           << result.counters.frames << ","
+           << result.counters.bytes << ","
+           << std::fixed << std::setprecision(3) << result.seconds << ","
+           << std::setprecision(0) << (result.seconds > 0 ? result.counters.frames / result.seconds : 0) << std::endl;
+    }
+
+    os << "Total: " << total_frames << " messages, " << total_bytes << " bytes in "
+       << std::setprecision(3) << wall_seconds << " s ("
+       << std::setprecision(0) << (wall_seconds > 0 ? total_frames / wall_seconds : 0) << " messages/s, "
+       << std::setprecision(1) << (wall_seconds > 0 ? total_bytes / wall_seconds / (1 << 20) : 0) << " MB/s)" << std::endl;
+    os << std::defaultfloat;
+}
@@ -0,0 +1,63 @@
+#ifndef BATCH_REPLAY_H
+#define BATCH_REPLAY_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include "replay.h"
+using namespace std;
+
+struct BatchReplayOptions
+{
+    size_t threads;
+    // Upper bound on the summed memory estimates of replays running at once.
+    uint64_t memory_budget;
+    // Per-day summaries are written here when non-empty. batch_parser creates the
+    // directory if it is missing; a summary that cannot be written fails its result.
+    string output_dir;
+    // Only these symbols are replayed when non-empty.
+    vector<string> symbols;
+    ReadMode read_mode;
+    // Applied to every capture.
+    ReplayWindow window;
+    // When set, every replay feeds its venue's top of book here. Each venue may
+    // only appear once among the captures, since a venue's quotes have a single writer.
+    ConsolidatedBbo *consolidated_bbo = nullptr;
+};
+
+struct BatchReplayResult
+{
+    string path;
+    Venue venue;
+    bool opened;
+    // False if output_dir is set and the day's summary could not be written.
+    bool summary_written;
+    ReplayCounters counters;
+    double seconds;
+};
+
+// Expands each argument as a glob pattern; arguments that match nothing are kept as-is.
+vector<string> expand_capture_paths(const vector<string> &patterns);
+
+// Rough peak footprint of replaying one capture: reader buffers plus a book
+// sized from the file length (compressed captures are assumed to be ~4x smaller).
+uint64_t estimate_replay_memory(const string &path);
+
+// Replays many captures on a pool of threads, each with its own Replay state.
+class BatchReplay
+{
+public:
+    explicit BatchReplay(const BatchReplayOptions &options) : options(options) {}
+
+    // Results are returned in the same order as paths.
+    vector<BatchReplayResult> run(const vector<string> &paths);
+
+    void print_throughput_report(const vector<BatchReplayResult> &results, double wall_seconds, std::ostream &os = std::cout) const;
+
+private:
+    BatchReplayOptions options;
+
+    bool write_day_summary(const BatchReplayResult &result) const;
+};
+
+#endif // BATCH_REPLAY_H
@@ -0,0 +1,43 @@
+#ifndef BOOK_DELTA_H
+#define BOOK_DELTA_H
+
+#include <cstdint>
+#include "price.h"
+
+// Market-by-price feed derived from the order book: one record per price level
+// whose size changed, carrying the level's new total. A level with no orders
+// left is sent with order_count and volume 0. Applying the records in order to
+// an initially empty book rebuilds every level exactly.
+
+constexpr char BOOK_DELTA_MAGIC[8] = {'I', 'T', 'C', 'H', 'M', 'B', 'P', 'D'};
+constexpr uint32_t BOOK_DELTA_VERSION = 1;
+
+struct BookDelta
+{
+    // Exchange time of the last message folded into the delta.
+    uint64_t timestamp;
+    uint64_t volume;
+    Price price;
+    uint32_t order_count;
+    // Deltas of one batch are written together, sorted by stock_locate, side and
+    // price; a consumer that applies whole batches never sees a half-updated book.
+    uint32_t batch;
+    uint16_t stock_locate;
+    char side;
+    uint8_t reserved;
+};
+
+static_assert(sizeof(BookDelta) == 32, "BookDelta is written to disk as is");
+
+// Layout of the delta file: this header followed by BookDeltas. Batch 0 holds
+// the levels already resting when publication started.
+struct BookDeltaFileHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    // Changes were coalesced over windows of this many nanoseconds of exchange time.
+    uint64_t coalesce_interval;
+};
+
+#endif // BOOK_DELTA_H
@@ -0,0 +1,71 @@
+#ifndef BOOK_PUBLISHER_H
+#define BOOK_PUBLISHER_H
+
+#include <memory>
+#include "book_snapshot.h"
+#include "order_book.h"
+#include "seqlock.h"
+using namespace std;
+
+// Top-of-book and top SNAPSHOT_DEPTH levels per stock_locate, published by the
+// thread that builds the book and read by any number of other threads. Each stock
+// has its own SeqLock, so publishing never blocks and readers of one stock do not
+// contend with writes to another.
+class BookPublisher
+{
+private:
+    size_t stock_locates;
+    unique_ptr<SeqLock<BookSnapshot>[]> snapshots;
+
+public:
+    explicit BookPublisher(size_t stock_locates = UINT16_MAX + 1)
+        : stock_locates(stock_locates), snapshots(new SeqLock<BookSnapshot>[stock_locates]) {}
+
+    // Writer side: refreshes the snapshot for stock_locate from the book. Nothing is
+    // written if the top levels are unchanged, so readers are not disturbed by
+    // updates deeper in the book.
+    void publish(const OrderBook &book, uint16_t stock_locate, uint64_t timestamp)
+    {
+        if (stock_locate >= stock_locates)
+        {
+            return;
+        }
+
+        BookSnapshot snapshot = book.get_snapshot(stock_locate, timestamp);
+        if (same_book(snapshots[stock_locate].peek(), snapshot))
+        {
+            return;
+        }
+        snapshots[stock_locate].store(snapshot);
+    }
+
+    // Reader side, a single attempt that never spins. Returns false if the writer
+    // was publishing this stock at the same moment.
+    bool try_read(uint16_t stock_locate, BookSnapshot &snapshot) const
+    {
+        return stock_locate < stock_locates && snapshots[stock_locate].try_load(snapshot);
+    }
+
+    // Reader side, retries until it gets a consistent copy.
+    void read(uint16_t stock_locate, BookSnapshot &snapshot) const
+    {
+        if (stock_locate < stock_locates)
+        {
+            snapshots[stock_locate].load(snapshot);
+        }
+    }
+
+    // Valid stock_locates are below this.
+    size_t stock_locate_count() const
+    {
+        return stock_locates;
+    }
+
+    // Cheap change detection for pollers: the version moves on every publish.
+    uint64_t version(uint16_t stock_locate) const
+    {
+        return (stock_locate < stock_locates) ? snapshots[stock_locate].version() : 0;
+    }
+};
+
+#endif // BOOK_PUBLISHER_H
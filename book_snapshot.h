@@ -0,0 +1,66 @@
+#ifndef BOOK_SNAPSHOT_H
+#define BOOK_SNAPSHOT_H
+
+#include <cstdint>
+#include <cstring>
+#include "price.h"
+
+constexpr uint32_t SNAPSHOT_DEPTH = 5;
+
+struct DepthLevel
+{
+    Price price;
+    uint32_t order_count;
+    uint64_t volume;
+};
+
+// Best SNAPSHOT_DEPTH levels on each side, best first. Only the first
+// bid_levels / ask_levels entries are meaningful. trading_state and state_flags
+// are the stock's SymbolState when the snapshot was taken, so readers can tell a
+// halted book from a live one.
+struct BookSnapshot
+{
+    uint64_t timestamp;
+    uint32_t bid_levels;
+    uint32_t ask_levels;
+    DepthLevel bids[SNAPSHOT_DEPTH];
+    DepthLevel asks[SNAPSHOT_DEPTH];
+    char trading_state;
+    uint8_t state_flags;
+    uint8_t reserved[6];
+};
+
+// True if the snapshots differ only in their timestamp; publishers skip such updates
+// so readers are not disturbed by changes deeper in the book.
+inline bool same_book(const BookSnapshot &a, const BookSnapshot &b)
+{
+    return memcmp(&a.bid_levels, &b.bid_levels, sizeof(BookSnapshot) - sizeof(a.timestamp)) == 0;
+}
+
+// True if each side holds at most SNAPSHOT_DEPTH non-empty levels, best first.
+// Readers use it to check the copies they take.
+inline bool well_formed(const BookSnapshot &snapshot)
+{
+    auto side_in_order = [](const DepthLevel *levels, uint32_t count, bool bids)
+    {
+        if (count > SNAPSHOT_DEPTH)
+        {
+            return false;
+        }
+        for (uint32_t i = 0; i < count; i++)
+        {
+            if (levels[i].order_count == 0 || levels[i].volume == 0)
+            {
+                return false;
+            }
+            if (i > 0 && (bids ? levels[i].price >= levels[i - 1].price : levels[i].price <= levels[i - 1].price))
+            {
+                return false;
+            }
+        }
+        return true;
+    };
+    return side_in_order(snapshot.bids, snapshot.bid_levels, true) && side_in_order(snapshot.asks, snapshot.ask_levels, false);
+}
+
+#endif // BOOK_SNAPSHOT_H
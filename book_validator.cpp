@@ -0,0 +1,311 @@
+#include <algorithm>
+#include <tuple>
+#include <unordered_map>
+#include "book_validator.h"
+#include "feed_reader.h"
+
+static bool level_less(const LevelSummary &a, const LevelSummary &b)
+{
+    return std::tie(a.stock_locate, a.side, a.price) < std::tie(b.stock_locate, b.side, b.price);
+}
+
+struct ReferenceOrder
+{
+    uint16_t stock_locate;
+    char side;
+    Price price;
+    uint32_t volume;
+};
+
+static void reduce_reference_order(unordered_map<uint64_t, ReferenceOrder> &orders, uint64_t order_reference_number, uint32_t shares)
+{
+    auto it = orders.find(order_reference_number);
+    if (it == orders.end())
+    {
+        return;
+    }
+    if (shares >= it->second.volume)
+    {
+        orders.erase(it);
+    }
+    else
+    {
+        it->second.volume -= shares;
+    }
+}
+
+vector<LevelSummary> rebuild_levels(const string &path, ReadMode read_mode, uint64_t frames, SymbolFilter symbol_filter, bool &opened)
+{
+    vector<LevelSummary> summaries;
+    FeedReader reader;
+    opened = reader.open(path, read_mode);
+    if (!opened)
+    {
+        return summaries;
+    }
+
+    unordered_map<uint64_t, ReferenceOrder> orders;
+    const char *frame;
+    uint16_t frame_length;
+
+    for (uint64_t count = 0; count < frames && reader.next_frame(frame, frame_length) == FrameStatus::OK; count++)
+    {
+        if (frame_length == 0 || frame_length - 1 != expected_message_length(frame[0]) ||
+            (symbol_filter.enabled() && !symbol_filter.accepts_frame(frame, frame_length)))
+        {
+            continue;
+        }
+
+        const char *body = &frame[1];
+        uint16_t length = frame_length - 1;
+        switch (get_message_type(frame[0]))
+        {
+        case MessageType::STOCK_DIRECTORY_MESSAGE:
+        {
+            StockDirectoryMessage message = parse_stock_directory_message(body);
+            symbol_filter.on_stock_directory(message);
+            break;
+        }
+        case MessageType::ADD_ORDER_MESSAGE:
+        {
+            AddOrderMessage message = parse_add_order_message(body, length);
+            orders.try_emplace(message.order_reference_number,
+                               ReferenceOrder{message.header.stock_locate, message.buy_sell_indicator, message.price, message.shares});
+            break;
+        }
+        case MessageType::DELETE_CANCEL_MESSAGE:
+        {
+            DeleteCancelMessage message = parse_delete_cancel_message(body, length);
+            if (message.delete_cancel_indicator == 'D')
+            {
+                orders.erase(message.order_reference_number);
+            }
+            else
+            {
+                reduce_reference_order(orders, message.order_reference_number, message.cancelled_shares);
+            }
+            break;
+        }
+        case MessageType::REPLACE_MESSAGE:
+        {
+            ReplaceOrderMessage message = parse_replace_order_message(body);
+            auto it = orders.find(message.original_order_reference_number);
+            if (it != orders.end())
+            {
+                ReferenceOrder order = {message.header.stock_locate, it->second.side, message.price, message.shares};
+                orders.erase(it);
+                orders.try_emplace(message.new_order_reference_number, order);
+            }
+            break;
+        }
+        case MessageType::ORDER_EXECUTED_MESSAGE:
+        {
+            OrderExecutedMessage message = parse_order_executed_message(body);
+            reduce_reference_order(orders, message.order_reference_number, message.executed_shares);
+            break;
+        }
+        case MessageType::ORDER_EXECUTED_PRICE_MESSAGE:
+        {
+            OrderExecutedPriceMessage message = parse_order_executed_price_message(body);
+            reduce_reference_order(orders, message.order_reference_number, message.executed_shares);
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    for (const auto &[order_reference_number, order] : orders)
+    {
+        summaries.push_back({order.stock_locate, order.side, order.price, 1, order.volume});
+    }
+    std::sort(summaries.begin(), summaries.end(), level_less);
+
+    // Collapse the per-order entries into one per level.
+    size_t levels = 0;
+    for (size_t i = 0; i < summaries.size(); i++)
+    {
+        if (levels > 0 && !level_less(summaries[levels - 1], summaries[i]))
+        {
+            summaries[levels - 1].order_count++;
+            summaries[levels - 1].volume += summaries[i].volume;
+        }
+        else
+        {
+            summaries[levels++] = summaries[i];
+        }
+    }
+    summaries.resize(levels);
+    return summaries;
+}
+
+BookValidator::BookValidator(const string &path, const BookValidatorOptions &options, const SymbolFilter &symbol_filter)
+    : path(path), options(options), symbol_filter(symbol_filter), frames_to_sample(options.sample_interval)
+{
+    vector<uint64_t> &checkpoints = this->options.checkpoints;
+    std::sort(checkpoints.begin(), checkpoints.end());
+    checkpoints.erase(std::unique(checkpoints.begin(), checkpoints.end()), checkpoints.end());
+}
+
+BookValidator::~BookValidator()
+{
+    finish();
+}
+
+void BookValidator::on_frame(const char *frame, uint16_t frame_length, uint64_t frames, const OrderBook &book)
+{
+    if (frame_length == 1 + expected_message_length('S') && frame[0] == 'S')
+    {
+        // Crossed books are only unexpected between the start and end of market hours.
+        char event_code = frame[1 + 10];
+        if (event_code == 'Q')
+        {
+            market_open = true;
+        }
+        else if (event_code == 'M')
+        {
+            market_open = false;
+        }
+    }
+
+    if (options.sample_interval > 0 && --frames_to_sample == 0)
+    {
+        frames_to_sample = options.sample_interval;
+        sample(frames, book);
+    }
+
+    if (next_checkpoint < options.checkpoints.size() && frames == options.checkpoints[next_checkpoint])
+    {
+        next_checkpoint++;
+        start_checkpoint(frames, book);
+    }
+}
+
+void BookValidator::sample(uint64_t frames, const OrderBook &book)
+{
+    size_t stock_locates = book.stock_locate_count();
+    if (stock_locates == 0)
+    {
+        return;
+    }
+
+    report.samples++;
+    uint64_t errors = report.structural_errors + report.crossed_books;
+    uint32_t levels_left = options.levels_per_sample;
+
+    // Stops early after a whole sweep so an empty book does not spin.
+    for (size_t sides = 0; levels_left > 0 && sides <= 2 * stock_locates; sides++)
+    {
+        if (sweep_stock_locate >= stock_locates)
+        {
+            sweep_stock_locate = 0;
+            report.sweeps++;
+        }
+        if (sweep_side == 'B' && sweep_price == Price::max() && market_open &&
+            book.symbol_state(sweep_stock_locate).trading_state == 'T' && book.is_crossed(sweep_stock_locate))
+        {
+            report.crossed_books++;
+        }
+
+        LevelCheck check = book.check_levels(sweep_stock_locate, sweep_side, sweep_price, levels_left);
+        levels_left -= check.levels;
+        report.levels_checked += check.levels;
+        report.structural_errors += check.errors;
+        if (!check.done)
+        {
+            continue;
+        }
+
+        if (sweep_side == 'B')
+        {
+            sweep_side = 'S';
+            sweep_price = Price::min();
+        }
+        else
+        {
+            sweep_stock_locate++;
+            sweep_side = 'B';
+            sweep_price = Price::max();
+        }
+    }
+
+    if (report.first_error_frame == 0 && report.structural_errors + report.crossed_books > errors)
+    {
+        report.first_error_frame = frames;
+    }
+}
+
+void BookValidator::start_checkpoint(uint64_t frames, const OrderBook &book)
+{
+    vector<LevelSummary> levels;
+    for (size_t stock_locate = 0; stock_locate < book.stock_locate_count(); stock_locate++)
+    {
+        book.for_each_level((uint16_t)stock_locate, [&](char side, const PriceLevel &level)
+                            { levels.push_back({(uint16_t)stock_locate, side, level.price, level.order_count, level.volume}); });
+    }
+    std::sort(levels.begin(), levels.end(), level_less);
+
+    pending_checkpoints.push_back(std::async(std::launch::async, [this, frames, levels = std::move(levels)]()
+                                             {
+        CheckpointResult result = {.frames = frames, .opened = false, .levels = levels.size(), .rebuilt_levels = 0, .mismatched_levels = 0};
+        vector<LevelSummary> rebuilt = rebuild_levels(path, options.read_mode, frames, symbol_filter, result.opened);
+        result.rebuilt_levels = rebuilt.size();
+
+        // Both sides are sorted, so a merge finds levels missing on either side or different.
+        size_t i = 0, j = 0;
+        while (i < levels.size() || j < rebuilt.size())
+        {
+            if (j == rebuilt.size() || (i < levels.size() && level_less(levels[i], rebuilt[j])))
+            {
+                result.mismatched_levels++;
+                i++;
+            }
+            else if (i == levels.size() || level_less(rebuilt[j], levels[i]))
+            {
+                result.mismatched_levels++;
+                j++;
+            }
+            else
+            {
+                result.mismatched_levels += !(levels[i] == rebuilt[j]);
+                i++;
+                j++;
+            }
+        }
+        return result; }));
+}
+
+const ValidationReport &BookValidator::finish()
+{
+    for (std::future<CheckpointResult> &pending : pending_checkpoints)
+    {
+        report.checkpoints.push_back(pending.get());
+    }
+    pending_checkpoints.clear();
+    return report;
+}
+
+void BookValidator::print_report(std::ostream &os) const
+{
+    os << "Validation samples: " << std::dec << report.samples
+       << " | Levels checked: " << report.levels_checked
+       << " | Sweeps: " << report.sweeps
+       << " | Structural errors: " << report.structural_errors
+       << " | Crossed books: " << report.crossed_books << std::endl;
+    if (report.first_error_frame > 0)
+    {
+        os << "First failed check after message " << report.first_error_frame << std::endl;
+    }
+
+    for (const CheckpointResult &checkpoint : report.checkpoints)
+    {
+        os << "Checkpoint at message " << checkpoint.frames << ": ";
+        if (!checkpoint.opened)
+        {
+            os << "rebuild could not open the capture" << std::endl;
+            continue;
+        }
+        os << checkpoint.levels << " levels, " << checkpoint.rebuilt_levels << " rebuilt, "
+           << checkpoint.mismatched_levels << " mismatched" << std::endl;
+    }
+}
@@ -0,0 +1,109 @@
+#ifndef BOOK_VALIDATOR_H
+#define BOOK_VALIDATOR_H
+
+#include <future>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "feed_reader.h"
+#include "helper.h"
+#include "instrument_table.h"
+#include "order_book.h"
+#include "symbol_filter.h"
+using namespace std;
+
+struct BookValidatorOptions
+{
+    // Every sample_interval messages the next levels_per_sample price levels get
+    // their invariants checked, sweeping all stocks in turn. 0 disables sampling.
+    uint64_t sample_interval;
+    uint32_t levels_per_sample;
+    // Message counts at which the book is compared against one rebuilt from
+    // scratch. Each rebuild reads the capture again, so there are none by default.
+    vector<uint64_t> checkpoints;
+    // How the rebuilds read the capture, normally the replay's own read mode.
+    ReadMode read_mode;
+};
+
+// Aggregate of one price level, as compared between the book and the rebuild.
+struct LevelSummary
+{
+    uint16_t stock_locate;
+    char side;
+    Price price;
+    uint32_t order_count;
+    uint64_t volume;
+
+    bool operator==(const LevelSummary &other) const = default;
+};
+
+struct CheckpointResult
+{
+    uint64_t frames;
+    bool opened;
+    uint64_t levels;
+    uint64_t rebuilt_levels;
+    uint64_t mismatched_levels;
+};
+
+struct ValidationReport
+{
+    uint64_t samples;
+    uint64_t levels_checked;
+    // Full passes over every stock_locate.
+    uint64_t sweeps;
+    uint64_t structural_errors;
+    uint64_t crossed_books;
+    // Message count at which the first sampled check failed, 0 if none did.
+    uint64_t first_error_frame;
+    vector<CheckpointResult> checkpoints;
+};
+
+// Replays the first frames messages of the capture into a plain map of orders,
+// independent of OrderBook, and returns its level aggregates in the order used
+// by BookValidator. opened is false if the capture could not be read.
+vector<LevelSummary> rebuild_levels(const string &path, ReadMode read_mode, uint64_t frames, SymbolFilter symbol_filter, bool &opened);
+
+// Checks a live OrderBook while a capture is replayed, cheaply enough to leave
+// on in release builds. Sampled checks walk a few levels at a time; crossed
+// books are only flagged for stocks trading during market hours, since they are
+// expected around auctions. At checkpoints the level aggregates are copied and
+// diffed on a background thread against a rebuild of the capture up to that
+// message, so the replay only pays for the copy.
+class BookValidator
+{
+public:
+    // symbol_filter must be the replay's filter before any message was applied.
+    BookValidator(const string &path, const BookValidatorOptions &options, const SymbolFilter &symbol_filter);
+    ~BookValidator();
+
+    BookValidator(const BookValidator &) = delete;
+    BookValidator &operator=(const BookValidator &) = delete;
+
+    // Called after each frame is applied; frames is the number of frames read so far.
+    void on_frame(const char *frame, uint16_t frame_length, uint64_t frames, const OrderBook &book);
+
+    // Waits for the outstanding rebuilds.
+    const ValidationReport &finish();
+
+    void print_report(std::ostream &os = std::cout) const;
+
+private:
+    string path;
+    BookValidatorOptions options;
+    SymbolFilter symbol_filter;
+    size_t next_checkpoint = 0;
+    uint64_t frames_to_sample;
+    // Where the sampled sweep resumes.
+    uint16_t sweep_stock_locate = 0;
+    char sweep_side = 'B';
+    Price sweep_price = Price::max();
+    bool market_open = false;
+    vector<std::future<CheckpointResult>> pending_checkpoints;
+    ValidationReport report = {};
+
+    void sample(uint64_t frames, const OrderBook &book);
+    void start_checkpoint(uint64_t frames, const OrderBook &book);
+};
+
+#endif // BOOK_VALIDATOR_H
@@ -33,7 +33,7 @@ with open(book_path) as file:
             split_line = line.split(",")
             
             side = split_line[0]
-            price = int(split_line[2])
+            price = round(float(split_line[2]) * 10000)
             volume = int(split_line[3])
             
             price_bucket = price // 1000
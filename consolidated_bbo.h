@@ -0,0 +1,170 @@
+#ifndef CONSOLIDATED_BBO_H
+#define CONSOLIDATED_BBO_H
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "order_book.h"
+#include "seqlock.h"
+#include "venue.h"
+using namespace std;
+
+constexpr uint32_t NO_SYMBOL = UINT32_MAX;
+
+// Best bid and offer of one symbol on one venue. A price of 0 means the side is empty.
+struct VenueQuote
+{
+    uint64_t timestamp;
+    uint64_t bid_volume;
+    uint64_t ask_volume;
+    Price bid_price;
+    Price ask_price;
+};
+
+// Best prices across venues. The volume is the total shown at that price on
+// every venue quoting it, and the venue masks have bit (1 << venue) set for each.
+struct ConsolidatedQuote
+{
+    uint64_t bid_volume;
+    uint64_t ask_volume;
+    Price bid_price;
+    Price ask_price;
+    uint8_t bid_venues;
+    uint8_t ask_venues;
+};
+
+// Cross-venue top of book, fed by one Replay per venue running on its own
+// thread. Venues number their stocks independently, so symbols get a shared id
+// when a venue's stock directory names them, and each venue maps its
+// stock_locates to those ids in a flat table. Every venue writes only its own
+// SeqLock slot per symbol, so replays never contend; the consolidated quote is
+// folded from the venue slots when it is read. Each slot keeps the exchange time
+// of its venue's last update, since venue replays do not advance in lockstep.
+class ConsolidatedBbo
+{
+public:
+    explicit ConsolidatedBbo(size_t max_symbols = UINT16_MAX + 1)
+        : max_symbols(max_symbols), quotes(new SeqLock<VenueQuote>[max_symbols * VENUE_COUNT])
+    {
+        for (vector<uint32_t> &symbols : locate_symbols)
+        {
+            symbols.assign(UINT16_MAX + 1, NO_SYMBOL);
+        }
+    }
+
+    // Called from the venue's replay on each stock directory message.
+    void on_stock_directory(Venue venue, uint16_t stock_locate, const string &stock)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto [it, inserted] = symbol_ids.try_emplace(stock, (uint32_t)symbols.size());
+        if (inserted)
+        {
+            if (symbols.size() == max_symbols)
+            {
+                symbol_ids.erase(it);
+                return;
+            }
+            symbols.push_back(stock);
+        }
+        locate_symbols[(size_t)venue][stock_locate] = it->second;
+    }
+
+    // Writer side, one thread per venue: refreshes the venue's quote for the stock from its book.
+    void publish(Venue venue, const OrderBook &book, uint16_t stock_locate, uint64_t timestamp)
+    {
+        uint32_t symbol = locate_symbols[(size_t)venue][stock_locate];
+        if (symbol == NO_SYMBOL)
+        {
+            return;
+        }
+
+        // A halted or quotation-only venue cannot trade the symbol, so its quote is
+        // withdrawn from the consolidated one until trading resumes there.
+        DepthLevel bid = {};
+        DepthLevel ask = {};
+        if (!(book.symbol_state(stock_locate).flags & (SYMBOL_HALTED | SYMBOL_QUOTATION_ONLY)))
+        {
+            book.get_bid_depth(stock_locate, &bid, 1);
+            book.get_ask_depth(stock_locate, &ask, 1);
+        }
+
+        SeqLock<VenueQuote> &slot = quotes[symbol * VENUE_COUNT + (size_t)venue];
+        VenueQuote previous = slot.peek();
+        if (previous.bid_price == bid.price && previous.bid_volume == bid.volume &&
+            previous.ask_price == ask.price && previous.ask_volume == ask.volume)
+        {
+            return;
+        }
+        slot.store({.timestamp = timestamp,
+                    .bid_volume = bid.volume,
+                    .ask_volume = ask.volume,
+                    .bid_price = bid.price,
+                    .ask_price = ask.price});
+    }
+
+    // Reader side, from any thread.
+    void read_venue(uint32_t symbol, Venue venue, VenueQuote &quote) const
+    {
+        quotes[symbol * VENUE_COUNT + (size_t)venue].load(quote);
+    }
+
+    ConsolidatedQuote read(uint32_t symbol) const
+    {
+        ConsolidatedQuote consolidated = {};
+        for (size_t venue = 0; venue < VENUE_COUNT; venue++)
+        {
+            VenueQuote quote;
+            read_venue(symbol, (Venue)venue, quote);
+            if (quote.bid_price.raw != 0 && quote.bid_price >= consolidated.bid_price)
+            {
+                if (quote.bid_price > consolidated.bid_price)
+                {
+                    consolidated.bid_price = quote.bid_price;
+                    consolidated.bid_volume = 0;
+                    consolidated.bid_venues = 0;
+                }
+                consolidated.bid_volume += quote.bid_volume;
+                consolidated.bid_venues |= 1 << venue;
+            }
+            if (quote.ask_price.raw != 0 && (consolidated.ask_price.raw == 0 || quote.ask_price <= consolidated.ask_price))
+            {
+                if (consolidated.ask_price.raw == 0 || quote.ask_price < consolidated.ask_price)
+                {
+                    consolidated.ask_price = quote.ask_price;
+                    consolidated.ask_volume = 0;
+                    consolidated.ask_venues = 0;
+                }
+                consolidated.ask_volume += quote.ask_volume;
+                consolidated.ask_venues |= 1 << venue;
+            }
+        }
+        return consolidated;
+    }
+
+    // Symbols registered so far; ids run from 0 to symbol_count() - 1.
+    size_t symbol_count()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return symbols.size();
+    }
+
+    string symbol(uint32_t id)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return (id < symbols.size()) ? symbols[id] : string();
+    }
+
+private:
+    size_t max_symbols;
+    std::unique_ptr<SeqLock<VenueQuote>[]> quotes;
+    // Written by the venue's own replay thread only.
+    vector<uint32_t> locate_symbols[VENUE_COUNT];
+
+    std::mutex mutex;
+    unordered_map<string, uint32_t> symbol_ids;
+    vector<string> symbols;
+};
+
+#endif // CONSOLIDATED_BBO_H
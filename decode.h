@@ -0,0 +1,63 @@
+#ifndef DECODE_H
+#define DECODE_H
+
+#include <byteswap.h>
+#include <cstdint>
+#include <cstring>
+#include "price.h"
+
+// Big-endian field decoders used by every message parser. They are compiled
+// into helper.cpp by default; building with ITCH_INLINE_DECODE makes helper.h
+// define them inline instead, so that callers outside helper.cpp can fold them
+// in without LTO.
+#ifdef ITCH_INLINE_DECODE
+#define ITCH_DECODE_FUNCTION inline
+#else
+#define ITCH_DECODE_FUNCTION
+#endif
+
+ITCH_DECODE_FUNCTION uint16_t parse_uint16_t(const char *x_char)
+{
+    uint16_t x;
+    memcpy(&x, x_char, 2);
+    return __bswap_16(x);
+}
+
+ITCH_DECODE_FUNCTION uint32_t parse_uint32_t(const char *x_char)
+{
+    uint32_t x;
+    memcpy(&x, x_char, 4);
+    return __bswap_32(x);
+}
+
+ITCH_DECODE_FUNCTION Price parse_price(const char *x_char)
+{
+    return Price(parse_uint32_t(x_char));
+}
+
+ITCH_DECODE_FUNCTION uint64_t parse_uint64_t(const char *x_char)
+{
+    uint64_t x;
+    memcpy(&x, x_char, 8);
+    return __bswap_64(x);
+}
+
+ITCH_DECODE_FUNCTION uint64_t parse_timestamp(const char *timestamp_char)
+{
+    uint64_t timestamp = 0;
+    memcpy(&timestamp, timestamp_char, 6);
+    timestamp = __bswap_64(timestamp);
+    return timestamp >> 16;
+}
+
+ITCH_DECODE_FUNCTION Header parse_header(const char *message)
+{
+    Header header = {
+        .stock_locate = parse_uint16_t(&message[0]),
+        .tracking_number = parse_uint16_t(&message[2]),
+        .timestamp = parse_timestamp(&message[4])};
+
+    return header;
+}
+
+#endif // DECODE_H
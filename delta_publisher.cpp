@@ -0,0 +1,144 @@
+#include <algorithm>
+#include <cstring>
+#include "delta_publisher.h"
+
+bool DeltaPublisher::open(const string &path)
+{
+    file.open(path, std::ios::binary);
+    if (!file)
+    {
+        return false;
+    }
+
+    BookDeltaFileHeader header = {};
+    memcpy(header.magic, BOOK_DELTA_MAGIC, sizeof(header.magic));
+    header.version = BOOK_DELTA_VERSION;
+    header.record_size = sizeof(BookDelta);
+    header.coalesce_interval = coalesce_interval;
+    file.write((const char *)&header, sizeof(header));
+    pending.reserve(WRITE_BATCH);
+    return (bool)file;
+}
+
+void DeltaPublisher::flush()
+{
+    if (file.is_open() && !pending.empty())
+    {
+        file.write((const char *)pending.data(), pending.size() * sizeof(BookDelta));
+        file.flush();
+    }
+    pending.clear();
+}
+
+void DeltaPublisher::start(OrderBook &book, uint64_t timestamp)
+{
+    started = true;
+    window_end = timestamp + coalesce_interval;
+    for (size_t stock_locate = 0; stock_locate < book.stock_locate_count(); stock_locate++)
+    {
+        book.for_each_level((uint16_t)stock_locate, [&](char side, const PriceLevel &level)
+                            {
+            published_levels[OrderBook::level_key((uint16_t)stock_locate, side, level.price)] = {level.order_count, level.volume};
+            write({.timestamp = timestamp,
+                   .volume = level.volume,
+                   .price = level.price,
+                   .order_count = level.order_count,
+                   .batch = 0,
+                   .stock_locate = (uint16_t)stock_locate,
+                   .side = side,
+                   .reserved = 0}); });
+    }
+    batch = 1;
+    book.set_level_change_tracking(true);
+}
+
+void DeltaPublisher::publish_batch(OrderBook &book)
+{
+    book.take_level_changes(changed_levels);
+    if (changed_levels.empty())
+    {
+        return;
+    }
+    level_changes += changed_levels.size();
+
+    std::sort(changed_levels.begin(), changed_levels.end());
+    changed_levels.erase(std::unique(changed_levels.begin(), changed_levels.end()), changed_levels.end());
+    bool written = false;
+    for (uint64_t key : changed_levels)
+    {
+        uint16_t stock_locate;
+        char side;
+        Price price;
+        OrderBook::split_level_key(key, stock_locate, side, price);
+        const PriceLevel *level = book.find_level(stock_locate, side, price);
+        PublishedLevel current = {.order_count = (level != nullptr) ? level->order_count : 0,
+                                  .volume = (level != nullptr) ? level->volume : 0};
+
+        // Levels missing from published_levels were last written empty, or never.
+        auto it = published_levels.find(key);
+        PublishedLevel previous = (it != published_levels.end()) ? it->second : PublishedLevel{0, 0};
+        if (current.order_count == previous.order_count && current.volume == previous.volume)
+        {
+            unchanged_levels++;
+            continue;
+        }
+        if (current.order_count == 0)
+        {
+            published_levels.erase(it);
+        }
+        else if (it != published_levels.end())
+        {
+            it->second = current;
+        }
+        else
+        {
+            published_levels.emplace(key, current);
+        }
+
+        write({.timestamp = last_timestamp,
+               .volume = current.volume,
+               .price = price,
+               .order_count = current.order_count,
+               .batch = batch,
+               .stock_locate = stock_locate,
+               .side = side,
+               .reserved = 0});
+        written = true;
+    }
+    if (written)
+    {
+        batch++;
+        nonempty_batches++;
+    }
+}
+
+void DeltaPublisher::finish(OrderBook &book)
+{
+    if (started)
+    {
+        publish_batch(book);
+        book.set_level_change_tracking(false);
+    }
+    flush();
+}
+
+void DeltaPublisher::print_summary(uint64_t frames, uint64_t feed_bytes, std::ostream &os) const
+{
+    uint64_t delta_bytes = sizeof(BookDeltaFileHeader) + deltas * sizeof(BookDelta);
+    os << "Book deltas: " << deltas << " in " << nonempty_batches << " batches"
+       << " | Level changes coalesced: " << level_changes
+       << " | Unchanged at the end of their window: " << unchanged_levels;
+    if (frames > 0)
+    {
+        os << " | Deltas per message: " << (double)deltas / frames;
+    }
+    if (feed_bytes > 0)
+    {
+        os << " | Bytes per feed byte: " << (double)delta_bytes / feed_bytes;
+        if (delta_bytes > feed_bytes)
+        {
+            os << " (larger than the feed: levels rarely change twice per window, a longer window may pay off)";
+        }
+    }
+    os << std::endl;
+}
@@ -0,0 +1,379 @@
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <linux/io_uring.h>
+#include "direct_source.h"
+#include "memory_policy.h"
+
+// O_DIRECT transfers must start and end on the device's logical block; 4 KB
+// covers both 512 byte and 4 KB sector devices.
+constexpr size_t DIRECT_IO_ALIGNMENT = 4096;
+
+// Just enough of an io_uring to submit reads and reap their completions,
+// using the raw system calls so that liburing is not needed.
+struct DirectSource::IoUring
+{
+    void *sq_ring = MAP_FAILED;
+    void *cq_ring = MAP_FAILED;
+    size_t sq_ring_size = 0;
+    size_t cq_ring_size = 0;
+    io_uring_sqe *sqes = (io_uring_sqe *)MAP_FAILED;
+    size_t sqes_size = 0;
+
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    io_uring_cqe *cqes;
+
+    ~IoUring()
+    {
+        if (sqes != MAP_FAILED)
+        {
+            munmap(sqes, sqes_size);
+        }
+        if (cq_ring != MAP_FAILED && cq_ring != sq_ring)
+        {
+            munmap(cq_ring, cq_ring_size);
+        }
+        if (sq_ring != MAP_FAILED)
+        {
+            munmap(sq_ring, sq_ring_size);
+        }
+    }
+};
+
+static unsigned load_acquire(unsigned *value)
+{
+    return std::atomic_ref<unsigned>(*value).load(std::memory_order_acquire);
+}
+
+static void store_release(unsigned *value, unsigned new_value)
+{
+    std::atomic_ref<unsigned>(*value).store(new_value, std::memory_order_release);
+}
+
+std::unique_ptr<DirectSource> DirectSource::open(const std::string &path, size_t chunk_size, size_t depth)
+{
+    // Filesystems such as tmpfs refuse O_DIRECT; those are read through the page cache.
+    bool direct_io = true;
+    int fd = ::open(path.c_str(), O_RDONLY | O_DIRECT);
+    if (fd < 0 && errno == EINVAL)
+    {
+        direct_io = false;
+        fd = ::open(path.c_str(), O_RDONLY);
+    }
+    struct stat file_stat;
+    if (fd < 0 || fstat(fd, &file_stat) != 0)
+    {
+        std::cerr << "Unable to open: " << path << std::endl;
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        return nullptr;
+    }
+
+    chunk_size = std::max(DIRECT_IO_ALIGNMENT, chunk_size / DIRECT_IO_ALIGNMENT * DIRECT_IO_ALIGNMENT);
+    return std::unique_ptr<DirectSource>(new DirectSource(fd, direct_io, file_stat.st_size, chunk_size, std::max(depth, (size_t)2)));
+}
+
+DirectSource::DirectSource(int fd, bool direct_io, uint64_t file_size, size_t chunk_size, size_t depth)
+    : fd(fd), direct_io(direct_io), file_size(file_size), chunk_size(chunk_size), chunks(depth)
+{
+    // Mapped memory is page aligned, which is what O_DIRECT needs.
+    chunk_memory = (char *)allocate_large(chunk_size * depth);
+    for (size_t index = 0; index < depth; index++)
+    {
+        chunks[index].data = chunk_memory + index * chunk_size;
+    }
+
+    if (!setup_io_uring(depth))
+    {
+        for (size_t i = 0; i < depth; i++)
+        {
+            workers.emplace_back(&DirectSource::pread_worker, this);
+        }
+    }
+
+    for (size_t index = 0; index < depth; index++)
+    {
+        submit(index);
+    }
+}
+
+DirectSource::~DirectSource()
+{
+    if (uses_io_uring())
+    {
+        // The kernel may still be writing into the chunks, so wait for every read.
+        for (size_t index = 0; index < chunks.size(); index++)
+        {
+            wait(index);
+        }
+        uring.reset();
+        close(uring_fd);
+    }
+    else
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        work_ready.notify_all();
+        for (std::thread &worker : workers)
+        {
+            worker.join();
+        }
+    }
+
+    free_large(chunk_memory, chunk_size * chunks.size());
+    close(fd);
+}
+
+bool DirectSource::setup_io_uring(size_t depth)
+{
+    io_uring_params params = {};
+    int ring_fd = (int)syscall(__NR_io_uring_setup, (unsigned)depth, &params);
+    if (ring_fd < 0)
+    {
+        return false;
+    }
+
+    auto ring = std::make_unique<IoUring>();
+    ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        ring->sq_ring_size = ring->cq_ring_size = std::max(ring->sq_ring_size, ring->cq_ring_size);
+    }
+
+    ring->sq_ring = mmap(nullptr, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ring != MAP_FAILED)
+    {
+        ring->cq_ring = (params.features & IORING_FEAT_SINGLE_MMAP)
+                            ? ring->sq_ring
+                            : mmap(nullptr, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+        ring->sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+        ring->sqes = (io_uring_sqe *)mmap(nullptr, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+    }
+    if (ring->sq_ring == MAP_FAILED || ring->cq_ring == MAP_FAILED || ring->sqes == MAP_FAILED)
+    {
+        ring.reset();
+        close(ring_fd);
+        return false;
+    }
+
+    char *sq = (char *)ring->sq_ring;
+    char *cq = (char *)ring->cq_ring;
+    ring->sq_head = (unsigned *)(sq + params.sq_off.head);
+    ring->sq_tail = (unsigned *)(sq + params.sq_off.tail);
+    ring->sq_mask = (unsigned *)(sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned *)(sq + params.sq_off.array);
+    ring->cq_head = (unsigned *)(cq + params.cq_off.head);
+    ring->cq_tail = (unsigned *)(cq + params.cq_off.tail);
+    ring->cq_mask = (unsigned *)(cq + params.cq_off.ring_mask);
+    ring->cqes = (io_uring_cqe *)(cq + params.cq_off.cqes);
+
+    uring_fd = ring_fd;
+    uring = std::move(ring);
+    return true;
+}
+
+// Starts reading the next chunk of the file into chunks[index].
+void DirectSource::submit(size_t index)
+{
+    Chunk &chunk = chunks[index];
+    chunk.offset = next_offset;
+    chunk.size = 0;
+    chunk.filled = false;
+    next_offset += chunk_size;
+    start_read(index);
+}
+
+// Reads the rest of chunks[index] after its first size bytes.
+void DirectSource::start_read(size_t index)
+{
+    Chunk &chunk = chunks[index];
+    // O_DIRECT reads must start on a block, so a read after a short one re-reads
+    // the partial block; the bytes it returns again are the same.
+    chunk.read_start = direct_io ? chunk.size / DIRECT_IO_ALIGNMENT * DIRECT_IO_ALIGNMENT : chunk.size;
+    chunk.result = 0;
+    chunk.done = false;
+
+    if (!uses_io_uring())
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending.push_back(index);
+        }
+        work_ready.notify_one();
+        return;
+    }
+
+    // Only this thread submits, and never more reads than the ring has entries.
+    unsigned tail = *uring->sq_tail;
+    unsigned slot = tail & *uring->sq_mask;
+    io_uring_sqe &sqe = uring->sqes[slot];
+    memset(&sqe, 0, sizeof(sqe));
+    sqe.opcode = IORING_OP_READ;
+    sqe.fd = fd;
+    sqe.addr = (uint64_t)(chunk.data + chunk.read_start);
+    sqe.len = (uint32_t)(chunk_size - chunk.read_start);
+    sqe.off = chunk.offset + chunk.read_start;
+    sqe.user_data = index;
+    uring->sq_array[slot] = slot;
+    store_release(uring->sq_tail, tail + 1);
+
+    long submitted;
+    while ((submitted = syscall(__NR_io_uring_enter, uring_fd, 1, 0, 0, nullptr, 0)) < 0 && errno == EINTR)
+    {
+    }
+    if (submitted < 1 && load_acquire(uring->sq_head) == tail)
+    {
+        // The kernel did not take the entry. Withdraw it, so that a later enter
+        // cannot start a read into the chunk after it has been handed back.
+        int error = (submitted < 0) ? errno : EAGAIN;
+        store_release(uring->sq_tail, tail);
+        chunk.result = -error;
+        chunk.done = true;
+    }
+}
+
+void DirectSource::reap_io_uring(bool block)
+{
+    unsigned head = *uring->cq_head;
+    if (block && head == load_acquire(uring->cq_tail))
+    {
+        while (syscall(__NR_io_uring_enter, uring_fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0 && errno == EINTR)
+        {
+        }
+    }
+
+    for (unsigned tail = load_acquire(uring->cq_tail); head != tail; head++)
+    {
+        const io_uring_cqe &cqe = uring->cqes[head & *uring->cq_mask];
+        Chunk &chunk = chunks[cqe.user_data];
+        chunk.result = cqe.res;
+        chunk.done = true;
+    }
+    store_release(uring->cq_head, head);
+}
+
+void DirectSource::wait(size_t index)
+{
+    if (uses_io_uring())
+    {
+        while (!chunks[index].done)
+        {
+            reap_io_uring(true);
+        }
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    chunk_done.wait(lock, [this, index]
+                    { return chunks[index].done; });
+}
+
+void DirectSource::pread_worker()
+{
+    while (true)
+    {
+        size_t index;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            work_ready.wait(lock, [this]
+                            { return stopping || !pending.empty(); });
+            if (stopping)
+            {
+                return;
+            }
+            index = pending.front();
+            pending.pop_front();
+        }
+
+        Chunk &chunk = chunks[index];
+        ssize_t bytes;
+        while ((bytes = pread(fd, chunk.data + chunk.read_start, chunk_size - chunk.read_start, (off_t)(chunk.offset + chunk.read_start))) < 0 &&
+               errno == EINTR)
+        {
+        }
+        int64_t result = (bytes < 0) ? -errno : bytes;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            chunk.result = result;
+            chunk.done = true;
+        }
+        chunk_done.notify_all();
+    }
+}
+
+// Waits until chunks[index] is complete, reading again after short reads that
+// stop before the end of the file. Returns false if a read failed.
+bool DirectSource::fill(size_t index)
+{
+    Chunk &chunk = chunks[index];
+    while (!chunk.filled)
+    {
+        wait(index);
+        if (chunk.result < 0)
+        {
+            return false;
+        }
+        chunk.size = chunk.read_start + (size_t)chunk.result;
+        // A read of 0 bytes before st_size means the file shrank; what was read is all there is.
+        if (chunk.result == 0 || chunk.size == chunk_size || chunk.offset + chunk.size >= file_size)
+        {
+            chunk.filled = true;
+        }
+        else
+        {
+            start_read(index);
+        }
+    }
+    return true;
+}
+
+size_t DirectSource::read(char *buffer, size_t capacity)
+{
+    size_t copied = 0;
+    while (copied < capacity && !end_of_file)
+    {
+        Chunk &chunk = chunks[current];
+        if (!fill(current))
+        {
+            std::cerr << "Read failed at offset " << chunk.offset + chunk.read_start << ": " << strerror((int)-chunk.result) << std::endl;
+            read_failed = true;
+            end_of_file = true;
+            break;
+        }
+
+        size_t bytes = std::min(capacity - copied, chunk.size - position);
+        memcpy(buffer + copied, chunk.data + position, bytes);
+        copied += bytes;
+        position += bytes;
+
+        if (position == chunk.size)
+        {
+            if (chunk.size < chunk_size || chunk.offset + chunk.size >= file_size)
+            {
+                end_of_file = true;
+                break;
+            }
+            submit(current);
+            current = (current + 1) % chunks.size();
+            position = 0;
+        }
+    }
+    return copied;
+}
@@ -0,0 +1,94 @@
+#ifndef DIRECT_SOURCE_H
+#define DIRECT_SOURCE_H
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "feed_reader.h"
+
+// Raw capture reader for files that are not in the page cache. The file is
+// opened with O_DIRECT when the filesystem allows it, and depth reads of
+// chunk_size bytes are kept in flight ahead of the consumer, through io_uring
+// when the kernel provides it and a small pool of pread threads otherwise.
+// Chunks are handed out strictly in file order; frames that straddle two
+// chunks are handled by FeedReader like any other buffer boundary.
+class DirectSource : public FeedSource
+{
+public:
+    static constexpr size_t DEFAULT_CHUNK_SIZE = 4 << 20;
+    static constexpr size_t DEFAULT_DEPTH = 8;
+
+    ~DirectSource() override;
+
+    // Returns nullptr if the file cannot be opened.
+    static std::unique_ptr<DirectSource> open(const std::string &path, size_t chunk_size = DEFAULT_CHUNK_SIZE, size_t depth = DEFAULT_DEPTH);
+
+    size_t read(char *buffer, size_t capacity) override;
+
+    bool uses_io_uring() const
+    {
+        return uring_fd >= 0;
+    }
+
+    bool uses_direct_io() const
+    {
+        return direct_io;
+    }
+
+private:
+    struct Chunk
+    {
+        char *data;
+        uint64_t offset;
+        // Bytes of data already read.
+        size_t size;
+        // Where the read in flight starts inside data.
+        size_t read_start;
+        // Bytes returned by the last read, or a negative errno.
+        int64_t result;
+        bool done;
+        // Set once the chunk is complete: full, or holding the end of the file.
+        bool filled;
+    };
+
+    struct IoUring;
+
+    int fd = -1;
+    bool direct_io = false;
+    uint64_t file_size;
+    size_t chunk_size;
+    char *chunk_memory = nullptr;
+    std::vector<Chunk> chunks;
+    uint64_t next_offset = 0;
+    // Chunk being consumed and the read position inside it.
+    size_t current = 0;
+    size_t position = 0;
+    bool end_of_file = false;
+
+    int uring_fd = -1;
+    std::unique_ptr<IoUring> uring;
+
+    // pread fallback: chunk indices waiting for a worker.
+    std::mutex mutex;
+    std::condition_variable work_ready;
+    std::condition_variable chunk_done;
+    std::deque<size_t> pending;
+    bool stopping = false;
+    std::vector<std::thread> workers;
+
+    DirectSource(int fd, bool direct_io, uint64_t file_size, size_t chunk_size, size_t depth);
+
+    bool setup_io_uring(size_t depth);
+    void submit(size_t index);
+    void start_read(size_t index);
+    void wait(size_t index);
+    bool fill(size_t index);
+    void reap_io_uring(bool block);
+    void pread_worker();
+};
+
+#endif // DIRECT_SOURCE_H
@@ -0,0 +1,171 @@
+#ifndef EVENT_CLOCK_H
+#define EVENT_CLOCK_H
+
+#include <iostream>
+#include <algorithm>
+#include <functional>
+#include <vector>
+#include "helper.h"
+using namespace std;
+
+constexpr uint64_t NANOSECONDS_PER_SECOND = 1000000000ull;
+constexpr uint64_t SECONDS_PER_DAY = 86400;
+
+// Exchange (message timestamp) time for a replay. Time only moves forward: a
+// timestamp older than the current time is counted as out of order and ignored.
+// Interval consumers (bars, snapshots) register a callback that fires once per
+// boundary crossed, and per-second message counts are kept for burst profiles.
+// The per-message cost is a compare against the next boundary; divisions only
+// happen when a boundary is actually crossed.
+class EventClock
+{
+private:
+    struct Interval
+    {
+        uint64_t interval;
+        uint64_t next_tick;
+        function<void(uint64_t)> on_tick;
+    };
+
+    bool started = false;
+    uint64_t current_time = 0;
+    uint64_t next_boundary = UINT64_MAX;
+    vector<Interval> intervals;
+
+    uint64_t second_end = 0;
+    uint64_t second_index = 0;
+    uint32_t second_messages = 0;
+    vector<uint32_t> messages_per_second = vector<uint32_t>(SECONDS_PER_DAY, 0);
+
+    uint64_t out_of_order = 0;
+    uint64_t max_regression = 0;
+
+    void roll_second()
+    {
+        if (second_index < messages_per_second.size())
+        {
+            messages_per_second[second_index] += second_messages;
+        }
+        second_index = current_time / NANOSECONDS_PER_SECOND;
+        second_end = (second_index + 1) * NANOSECONDS_PER_SECOND;
+        second_messages = 0;
+    }
+
+    // The first message sets the clock without firing every boundary since midnight.
+    void start(uint64_t timestamp)
+    {
+        started = true;
+        current_time = timestamp;
+        next_boundary = UINT64_MAX;
+        for (Interval &interval : intervals)
+        {
+            interval.next_tick = (timestamp / interval.interval + 1) * interval.interval;
+            next_boundary = std::min(next_boundary, interval.next_tick);
+        }
+    }
+
+    void fire_intervals()
+    {
+        next_boundary = UINT64_MAX;
+        for (Interval &interval : intervals)
+        {
+            while (current_time >= interval.next_tick)
+            {
+                interval.on_tick(interval.next_tick);
+                interval.next_tick += interval.interval;
+            }
+            next_boundary = std::min(next_boundary, interval.next_tick);
+        }
+    }
+
+public:
+    // on_tick is called with the boundary time each time exchange time reaches a
+    // multiple of interval_ns, before the message that crossed it is applied.
+    // Returns false, registering nothing, if interval_ns is 0.
+    bool add_interval(uint64_t interval_ns, function<void(uint64_t)> on_tick)
+    {
+        if (interval_ns == 0)
+        {
+            return false;
+        }
+        uint64_t first_tick = (current_time / interval_ns + 1) * interval_ns;
+        intervals.push_back({interval_ns, first_tick, std::move(on_tick)});
+        next_boundary = std::min(next_boundary, first_tick);
+        return true;
+    }
+
+    void advance(uint64_t timestamp)
+    {
+        if (!started)
+        {
+            start(timestamp);
+        }
+
+        if (timestamp < current_time)
+        {
+            out_of_order++;
+            max_regression = std::max(max_regression, current_time - timestamp);
+        }
+        else
+        {
+            current_time = timestamp;
+            if (current_time >= second_end)
+            {
+                roll_second();
+            }
+            if (current_time >= next_boundary)
+            {
+                fire_intervals();
+            }
+        }
+        second_messages++;
+    }
+
+    uint64_t now() const
+    {
+        return current_time;
+    }
+
+    uint64_t out_of_order_count() const
+    {
+        return out_of_order;
+    }
+
+    uint64_t max_regression_ns() const
+    {
+        return max_regression;
+    }
+
+    // Messages seen in each second of the exchange day, indexed by second since midnight.
+    const vector<uint32_t> &get_messages_per_second()
+    {
+        roll_second();
+        return messages_per_second;
+    }
+
+    void print_rate_profile(std::ostream &os = std::cout, size_t busiest = 10)
+    {
+        const vector<uint32_t> &rates = get_messages_per_second();
+        vector<uint32_t> seconds;
+        for (uint32_t second = 0; second < rates.size(); second++)
+        {
+            if (rates[second] > 0)
+            {
+                seconds.push_back(second);
+            }
+        }
+
+        busiest = std::min(busiest, seconds.size());
+        std::partial_sort(seconds.begin(), seconds.begin() + busiest, seconds.end(), [&rates](uint32_t a, uint32_t b)
+                          { return rates[a] > rates[b]; });
+
+        os << "Out of order timestamps: " << std::dec << out_of_order << " (max regression " << max_regression << " ns)" << std::endl;
+        os << "Second,Messages" << std::endl;
+        for (size_t i = 0; i < busiest; i++)
+        {
+            os << format_timestamp(seconds[i] * NANOSECONDS_PER_SECOND).substr(0, 8) << "," << rates[seconds[i]] << std::endl;
+        }
+    }
+};
+
+#endif // EVENT_CLOCK_H
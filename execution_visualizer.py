@@ -4,7 +4,7 @@ import sys
 prices = []
 with open(sys.argv[1]) as f:
     while line := f.readline():
-        price = int(line) / 10000.0
+        price = float(line)
         prices.append(price)
 
 plt.plot(prices)
@@ -0,0 +1,385 @@
+#include <iostream>
+#include <cstring>
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include "feed_reader.h"
+#include "direct_source.h"
+
+#ifdef ITCH_WITH_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef ITCH_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+class FileSource : public FeedSource
+{
+public:
+    explicit FileSource(int fd) : fd(fd) {}
+
+    ~FileSource() override
+    {
+        close(fd);
+    }
+
+    size_t read(char *buffer, size_t capacity) override
+    {
+        ssize_t bytes;
+        while ((bytes = ::read(fd, buffer, capacity)) < 0 && errno == EINTR)
+        {
+        }
+        if (bytes < 0)
+        {
+            std::cerr << "Read failed: " << strerror(errno) << std::endl;
+            read_failed = true;
+            return 0;
+        }
+        return (size_t)bytes;
+    }
+
+private:
+    int fd;
+};
+
+#ifdef ITCH_WITH_ZLIB
+class GzipSource : public FeedSource
+{
+public:
+    explicit GzipSource(gzFile file) : file(file)
+    {
+        gzbuffer(file, 1 << 20);
+    }
+
+    ~GzipSource() override
+    {
+        gzclose(file);
+    }
+
+    size_t read(char *buffer, size_t capacity) override
+    {
+        int bytes = gzread(file, buffer, (unsigned)std::min(capacity, (size_t)INT32_MAX));
+        int error = Z_OK;
+        const char *message = gzerror(file, &error);
+        // zlib reports a file cut off inside the stream as Z_BUF_ERROR with a 0 return.
+        if (bytes < 0 || (bytes == 0 && error == Z_BUF_ERROR))
+        {
+            std::cerr << "gzip: " << message << std::endl;
+            read_failed = true;
+            return 0;
+        }
+        return (size_t)bytes;
+    }
+
+private:
+    gzFile file;
+};
+#endif
+
+#ifdef ITCH_WITH_ZSTD
+class ZstdSource : public FeedSource
+{
+public:
+    ZstdSource(int fd) : fd(fd), context(ZSTD_createDCtx()), compressed(ZSTD_DStreamInSize())
+    {
+        input = {compressed.data(), 0, 0};
+    }
+
+    ~ZstdSource() override
+    {
+        ZSTD_freeDCtx(context);
+        close(fd);
+    }
+
+    size_t read(char *buffer, size_t capacity) override
+    {
+        ZSTD_outBuffer output = {buffer, capacity, 0};
+
+        while (output.pos == 0)
+        {
+            if (input.pos == input.size)
+            {
+                ssize_t bytes = ::read(fd, compressed.data(), compressed.size());
+                if (bytes < 0 && errno == EINTR)
+                {
+                    continue;
+                }
+                if (bytes < 0)
+                {
+                    std::cerr << "zstd: read failed: " << strerror(errno) << std::endl;
+                    read_failed = true;
+                    return 0;
+                }
+                if (bytes == 0)
+                {
+                    // A file that ends inside a frame was cut short.
+                    if (frame_pending)
+                    {
+                        std::cerr << "zstd: truncated input" << std::endl;
+                        read_failed = true;
+                    }
+                    return 0;
+                }
+                input = {compressed.data(), (size_t)bytes, 0};
+            }
+
+            size_t result = ZSTD_decompressStream(context, &output, &input);
+            if (ZSTD_isError(result))
+            {
+                std::cerr << "zstd: " << ZSTD_getErrorName(result) << std::endl;
+                read_failed = true;
+                return 0;
+            }
+            frame_pending = result != 0;
+        }
+        return output.pos;
+    }
+
+private:
+    int fd;
+    ZSTD_DCtx *context;
+    std::vector<char> compressed;
+    ZSTD_inBuffer input;
+    // ZSTD_decompressStream returns 0 only at the end of a frame.
+    bool frame_pending = false;
+};
+#endif
+
+static bool ends_with(const std::string &value, const std::string &suffix)
+{
+    return value.size() >= suffix.size() && value.compare(value.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+std::unique_ptr<FeedSource> open_feed_source(const std::string &path, ReadMode read_mode)
+{
+    bool compressed = ends_with(path, ".gz") || ends_with(path, ".zst") || ends_with(path, ".zstd");
+    if (read_mode == ReadMode::DIRECT && !compressed)
+    {
+        return DirectSource::open(path);
+    }
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        std::cerr << "Unable to open: " << path << std::endl;
+        return nullptr;
+    }
+
+    if (ends_with(path, ".gz"))
+    {
+#ifdef ITCH_WITH_ZLIB
+        gzFile file = gzdopen(fd, "rb");
+        if (file != nullptr)
+        {
+            return std::make_unique<GzipSource>(file);
+        }
+#else
+        std::cerr << "gzip input is not supported by this build: " << path << std::endl;
+#endif
+        close(fd);
+        return nullptr;
+    }
+
+    if (ends_with(path, ".zst") || ends_with(path, ".zstd"))
+    {
+#ifdef ITCH_WITH_ZSTD
+        return std::make_unique<ZstdSource>(fd);
+#else
+        std::cerr << "zstd input is not supported by this build: " << path << std::endl;
+        close(fd);
+        return nullptr;
+#endif
+    }
+
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    return std::make_unique<FileSource>(fd);
+}
+
+FeedReader::FeedReader(size_t buffer_size, size_t buffer_count)
+    : buffers(std::max(buffer_count, (size_t)2)), scratch(MAX_FRAME_LENGTH)
+{
+    for (Buffer &buffer : buffers)
+    {
+        buffer.data.resize(buffer_size);
+        buffer.size = 0;
+    }
+}
+
+FeedReader::~FeedReader()
+{
+    stop();
+}
+
+bool FeedReader::open(const std::string &path, ReadMode read_mode)
+{
+    return open(open_feed_source(path, read_mode));
+}
+
+bool FeedReader::open(std::unique_ptr<FeedSource> feed_source)
+{
+    stop();
+    if (feed_source == nullptr)
+    {
+        return false;
+    }
+
+    source = std::move(feed_source);
+    free_buffers.clear();
+    full_buffers.clear();
+    for (size_t i = 0; i < buffers.size(); i++)
+    {
+        free_buffers.push_back(i);
+    }
+    producer_done = false;
+    source_failed = false;
+    stopping = false;
+    current = NO_BUFFER;
+    cursor = end = nullptr;
+
+    producer = std::thread(&FeedReader::produce, this);
+    return true;
+}
+
+void FeedReader::stop()
+{
+    if (producer.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        buffer_ready.notify_all();
+        producer.join();
+    }
+    source.reset();
+}
+
+void FeedReader::produce()
+{
+    while (true)
+    {
+        size_t index;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            buffer_ready.wait(lock, [this]
+                              { return stopping || !free_buffers.empty(); });
+            if (stopping)
+            {
+                return;
+            }
+            index = free_buffers.front();
+            free_buffers.pop_front();
+        }
+
+        Buffer &buffer = buffers[index];
+        buffer.size = 0;
+        while (buffer.size < buffer.data.size())
+        {
+            size_t bytes = source->read(buffer.data.data() + buffer.size, buffer.data.size() - buffer.size);
+            if (bytes == 0)
+            {
+                break;
+            }
+            buffer.size += bytes;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (buffer.size > 0)
+            {
+                full_buffers.push_back(index);
+            }
+            producer_done = (buffer.size < buffer.data.size());
+            source_failed = producer_done && source->failed();
+        }
+        buffer_ready.notify_all();
+
+        if (producer_done)
+        {
+            return;
+        }
+    }
+}
+
+// Hands the current buffer back to the producer and waits for the next filled one.
+bool FeedReader::fetch_buffer()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    if (current != NO_BUFFER)
+    {
+        free_buffers.push_back(current);
+        current = NO_BUFFER;
+        buffer_ready.notify_all();
+    }
+
+    buffer_ready.wait(lock, [this]
+                      { return producer_done || !full_buffers.empty(); });
+    if (full_buffers.empty())
+    {
+        cursor = end = nullptr;
+        return false;
+    }
+
+    current = full_buffers.front();
+    full_buffers.pop_front();
+    cursor = buffers[current].data.data();
+    end = cursor + buffers[current].size;
+    return true;
+}
+
+bool FeedReader::gather(char *out, size_t count, size_t &copied)
+{
+    copied = 0;
+    while (copied < count)
+    {
+        if (cursor == end && !fetch_buffer())
+        {
+            return false;
+        }
+
+        size_t chunk = std::min(count - copied, (size_t)(end - cursor));
+        memcpy(out + copied, cursor, chunk);
+        cursor += chunk;
+        copied += chunk;
+    }
+    return true;
+}
+
+FrameStatus FeedReader::next_frame(const char *&frame, uint16_t &length)
+{
+    // Common case: the whole frame sits inside the current buffer and is used in place.
+    if (end - cursor >= 2)
+    {
+        uint16_t frame_length = parse_uint16_t(cursor);
+        if ((size_t)(end - cursor) >= 2 + (size_t)frame_length)
+        {
+            frame = cursor + 2;
+            length = frame_length;
+            cursor += 2 + frame_length;
+            return FrameStatus::OK;
+        }
+    }
+    return next_split_frame(frame, length);
+}
+
+FrameStatus FeedReader::next_split_frame(const char *&frame, uint16_t &length)
+{
+    char length_char[2];
+    size_t copied;
+
+    if (!gather(length_char, 2, copied))
+    {
+        return source_failed ? FrameStatus::READ_ERROR : (copied == 0) ? FrameStatus::END_OF_FEED : FrameStatus::TRUNCATED;
+    }
+
+    length = parse_uint16_t(length_char);
+    if (!gather(scratch.data(), length, copied))
+    {
+        return source_failed ? FrameStatus::READ_ERROR : FrameStatus::TRUNCATED;
+    }
+
+    frame = scratch.data();
+    return FrameStatus::OK;
+}
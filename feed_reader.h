@@ -0,0 +1,104 @@
+#ifndef FEED_READER_H
+#define FEED_READER_H
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "helper.h"
+#include "memory_policy.h"
+
+// Source of raw (already decompressed) feed bytes.
+class FeedSource
+{
+public:
+    virtual ~FeedSource() = default;
+
+    // Copies up to capacity bytes into buffer. Returns 0 once the input is
+    // exhausted or a read failed; failed() tells the two apart.
+    virtual size_t read(char *buffer, size_t capacity) = 0;
+
+    bool failed() const
+    {
+        return read_failed;
+    }
+
+protected:
+    bool read_failed = false;
+};
+
+// How raw captures are read. DIRECT bypasses the page cache and keeps several
+// reads in flight (see DirectSource), for archived days that are not cached.
+enum class ReadMode
+{
+    BUFFERED,
+    DIRECT
+};
+
+// Picks the source from the file extension: .gz for gzip, .zst/.zstd for zstd,
+// anything else is read as a raw capture. Returns nullptr if the file cannot be
+// opened or the format was not compiled in. Compressed captures are always read
+// through the page cache.
+std::unique_ptr<FeedSource> open_feed_source(const std::string &path, ReadMode read_mode = ReadMode::BUFFERED);
+
+// Splits a feed into length-prefixed frames. A background thread pulls bytes
+// from the FeedSource (decompressing if needed) into a ring of large buffers
+// while the caller decodes frames out of the previously filled ones.
+class FeedReader
+{
+public:
+    static constexpr size_t DEFAULT_BUFFER_SIZE = 8 << 20;
+    static constexpr size_t DEFAULT_BUFFER_COUNT = 4;
+
+    FeedReader(size_t buffer_size = DEFAULT_BUFFER_SIZE, size_t buffer_count = DEFAULT_BUFFER_COUNT);
+    ~FeedReader();
+
+    FeedReader(const FeedReader &) = delete;
+    FeedReader &operator=(const FeedReader &) = delete;
+
+    bool open(const std::string &path, ReadMode read_mode = ReadMode::BUFFERED);
+    bool open(std::unique_ptr<FeedSource> feed_source);
+
+    // On OK, frame points at the message type byte followed by the body, and
+    // stays valid until the next call. READ_ERROR is returned in place of
+    // END_OF_FEED or TRUNCATED once the frames read before a source error run out.
+    FrameStatus next_frame(const char *&frame, uint16_t &length);
+
+private:
+    struct Buffer
+    {
+        std::vector<char, PolicyAllocator<char>> data;
+        size_t size;
+    };
+
+    std::unique_ptr<FeedSource> source;
+    std::vector<Buffer> buffers;
+    std::deque<size_t> free_buffers;
+    std::deque<size_t> full_buffers;
+    std::mutex mutex;
+    std::condition_variable buffer_ready;
+    bool producer_done = false;
+    // Set with producer_done when the source stopped on an error rather than at its end.
+    bool source_failed = false;
+    bool stopping = false;
+    std::thread producer;
+
+    static constexpr size_t NO_BUFFER = SIZE_MAX;
+    size_t current = NO_BUFFER;
+    const char *cursor = nullptr;
+    const char *end = nullptr;
+
+    // Frames that straddle two buffers are copied here.
+    std::vector<char> scratch;
+
+    void produce();
+    void stop();
+    bool fetch_buffer();
+    bool gather(char *out, size_t count, size_t &copied);
+    FrameStatus next_split_frame(const char *&frame, uint16_t &length);
+};
+
+#endif // FEED_READER_H
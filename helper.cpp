@@ -1,12 +1,16 @@
 #include <iostream>
 #include <fstream>
 #include <cstring>
-#include <byteswap.h>
-#include <cassert>
 #include <algorithm>
 #include <iomanip>
 #include <chrono>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
 #include "helper.h"
+#ifndef ITCH_INLINE_DECODE
+#include "decode.h"
+#endif
 
 std::ostream &operator<<(std::ostream &os, MessageType type)
 {
@@ -60,6 +64,18 @@ std::ostream &operator<<(std::ostream &os, MessageType type)
     case MessageType::LULD_AUCTION_COLLAR:
         os << "LULD_AUCTION_COLLAR";
         break;
+    case MessageType::BROKEN_TRADE_MESSAGE:
+        os << "BROKEN_TRADE_MESSAGE";
+        break;
+    case MessageType::MWCB_STATUS_MESSAGE:
+        os << "MWCB_STATUS_MESSAGE";
+        break;
+    case MessageType::RPII_MESSAGE:
+        os << "RPII_MESSAGE";
+        break;
+    case MessageType::OPERATIONAL_HALT_MESSAGE:
+        os << "OPERATIONAL_HALT_MESSAGE";
+        break;
     case MessageType::UNKNOWN_MESSAGE:
     default:
         os << "UNKNOWN_MESSAGE";
@@ -68,103 +84,104 @@ std::ostream &operator<<(std::ostream &os, MessageType type)
     return os;
 }
 
-MessageType read_message_type(std::ifstream *fs)
+MessageType get_message_type(char message_type)
 {
-    char message_type;
-    if (fs->read(&message_type, 1))
+    switch (message_type)
     {
-        switch (message_type)
-        {
-        case 'S':
-            return MessageType::SYSTEM_EVENT_MESSAGE;
-        case 'R':
-            return MessageType::STOCK_DIRECTORY_MESSAGE;
-        case 'H':
-            return MessageType::STOCK_TRADING_ACTION_MESSAGE;
-        case 'Y':
-            return MessageType::REG_SHO_RESTRICTION;
-        case 'L':
-            return MessageType::MARKET_PARTICIPANT_POSITION;
-        case 'A':
-        case 'F':
-            return MessageType::ADD_ORDER_MESSAGE;
-        case 'X':
-        case 'D':
-            return MessageType::DELETE_CANCEL_MESSAGE;
-        case 'U':
-            return MessageType::REPLACE_MESSAGE;
-        case 'E':
-            return MessageType::ORDER_EXECUTED_MESSAGE;
-        case 'C':
-            return MessageType::ORDER_EXECUTED_PRICE_MESSAGE;
-        case 'P':
-            return MessageType::TRADE_NON_CROSS_MESSAGE;
-        case 'Q':
-            return MessageType::TRADE_CROSS_MESSAGE;
-        case 'V':
-            return MessageType::MWCB_DECLINE_MESSAGE;
-        case 'K':
-            return MessageType::IPO_QUOTING_PERIOD;
-        case 'I':
-            return MessageType::NOII_MESSAGE;
-        case 'J':
-            return MessageType::LULD_AUCTION_COLLAR;
-        default:
-            std::cout << "Received: " << message_type << std::endl;
-            return MessageType::UNKNOWN_MESSAGE;
-        }
+    case 'S':
+        return MessageType::SYSTEM_EVENT_MESSAGE;
+    case 'R':
+        return MessageType::STOCK_DIRECTORY_MESSAGE;
+    case 'H':
+        return MessageType::STOCK_TRADING_ACTION_MESSAGE;
+    case 'Y':
+        return MessageType::REG_SHO_RESTRICTION;
+    case 'L':
+        return MessageType::MARKET_PARTICIPANT_POSITION;
+    case 'A':
+    case 'F':
+        return MessageType::ADD_ORDER_MESSAGE;
+    case 'X':
+    case 'D':
+        return MessageType::DELETE_CANCEL_MESSAGE;
+    case 'U':
+        return MessageType::REPLACE_MESSAGE;
+    case 'E':
+        return MessageType::ORDER_EXECUTED_MESSAGE;
+    case 'C':
+        return MessageType::ORDER_EXECUTED_PRICE_MESSAGE;
+    case 'P':
+        return MessageType::TRADE_NON_CROSS_MESSAGE;
+    case 'Q':
+        return MessageType::TRADE_CROSS_MESSAGE;
+    case 'B':
+        return MessageType::BROKEN_TRADE_MESSAGE;
+    case 'V':
+        return MessageType::MWCB_DECLINE_MESSAGE;
+    case 'W':
+        return MessageType::MWCB_STATUS_MESSAGE;
+    case 'K':
+        return MessageType::IPO_QUOTING_PERIOD;
+    case 'I':
+        return MessageType::NOII_MESSAGE;
+    case 'J':
+        return MessageType::LULD_AUCTION_COLLAR;
+    case 'N':
+        return MessageType::RPII_MESSAGE;
+    case 'h':
+        return MessageType::OPERATIONAL_HALT_MESSAGE;
+    default:
+        return MessageType::UNKNOWN_MESSAGE;
     }
-    return MessageType::UNKNOWN_MESSAGE;
 }
 
-uint16_t parse_uint16_t(const char *x_char)
+uint16_t expected_message_length(char message_type)
 {
-    uint16_t x;
-    memcpy(&x, x_char, 2);
-    return __bswap_16(x);
-}
-
-uint32_t parse_uint32_t(const char *x_char)
-{
-    uint32_t x;
-    memcpy(&x, x_char, 4);
-    return __bswap_32(x);
-}
-
-uint64_t parse_uint64_t(const char *x_char)
-{
-    uint64_t x;
-    memcpy(&x, x_char, 8);
-    return __bswap_64(x);
-}
-
-uint64_t parse_timestamp(const char *timestamp_char)
-{
-    uint64_t timestamp;
-    memcpy(&timestamp, timestamp_char, 6);
-    timestamp = __bswap_64(timestamp);
-    return timestamp >> 16;
-}
-
-void dummy_read(std::ifstream *fs, uint32_t length)
-{
-    char *message = (char *)calloc(length, sizeof(char));
-    fs->read(message, length);
-    free(message);
-}
-
-uint16_t read_length(std::ifstream *fs)
-{
-    char length_char[2];
-    uint16_t length;
-
-    if (fs->read(length_char, 2))
-    {
-        memcpy(&length, length_char, sizeof(length_char));
-        return __bswap_16(length);
-    }
-    else
+    switch (message_type)
     {
+    case 'S':
+    case 'W':
+        return 11;
+    case 'R':
+        return 38;
+    case 'H':
+        return 24;
+    case 'Y':
+    case 'N':
+        return 19;
+    case 'L':
+        return 25;
+    case 'A':
+        return 35;
+    case 'F':
+        return 39;
+    case 'X':
+        return 22;
+    case 'D':
+        return 18;
+    case 'U':
+        return 34;
+    case 'E':
+        return 30;
+    case 'C':
+        return 35;
+    case 'P':
+        return 43;
+    case 'Q':
+        return 39;
+    case 'B':
+        return 18;
+    case 'V':
+        return 34;
+    case 'K':
+        return 27;
+    case 'I':
+        return 49;
+    case 'J':
+        return 34;
+    case 'h':
+        return 20;
+    default:
         return 0;
     }
 }
@@ -199,14 +216,50 @@ std::string format_timestamp(const uint64_t timestamp_ns)
     return oss.str();
 }
 
-Header parse_header(const char *message)
+bool parse_time_of_day(const std::string &text, uint64_t &timestamp_ns)
 {
-    Header header = {
-        .stock_locate = parse_uint16_t(&message[0]),
-        .tracking_number = parse_uint16_t(&message[2]),
-        .timestamp = parse_timestamp(&message[4])};
+    unsigned hours, minutes, seconds = 0;
+    int consumed = 0;
+    int fields = sscanf(text.c_str(), "%2u:%2u%n:%2u%n", &hours, &minutes, &consumed, &seconds, &consumed);
+    if (fields < 2 || hours > 23 || minutes > 59 || seconds > 59)
+    {
+        return false;
+    }
+
+    uint64_t nanoseconds = 0;
+    const char *rest = text.c_str() + consumed;
+    if (fields == 3 && *rest == '.')
+    {
+        uint64_t scale = 100000000;
+        for (rest++; isdigit((unsigned char)*rest) && scale > 0; rest++, scale /= 10)
+        {
+            nanoseconds += (*rest - '0') * scale;
+        }
+    }
+    if (*rest != '\0')
+    {
+        return false;
+    }
 
-    return header;
+    timestamp_ns = ((hours * 60ull + minutes) * 60 + seconds) * 1000000000ull + nanoseconds;
+    return true;
+}
+
+bool parse_unsigned(const std::string &text, uint64_t max_value, uint64_t &value)
+{
+    if (text.empty() || !isdigit((unsigned char)text[0]))
+    {
+        return false;
+    }
+    errno = 0;
+    char *end = nullptr;
+    unsigned long long parsed = strtoull(text.c_str(), &end, 10);
+    if (*end != '\0' || errno == ERANGE || parsed > max_value)
+    {
+        return false;
+    }
+    value = parsed;
+    return true;
 }
 
 void print_header(const Header &header)
@@ -223,20 +276,11 @@ void print_system_event_message(SystemEventMessage &msg)
     std::cout << "  System Event   : '" << msg.system_event << "'" << std::endl;
 }
 
-SystemEventMessage read_system_event_message(std::ifstream *fs, uint16_t length)
+SystemEventMessage parse_system_event_message(const char *message)
 {
-    assert(length == 11);
-
-    char *message = (char *)calloc(length, sizeof(char));
     SystemEventMessage parsed_message;
-
-    if (fs->read(message, length))
-    {
-        parsed_message.header = parse_header(&message[0]);
-        parsed_message.system_event = message[10];
-    }
-
-    free(message);
+    parsed_message.header = parse_header(&message[0]);
+    parsed_message.system_event = message[10];
     return parsed_message;
 }
 
@@ -260,33 +304,24 @@ void print_stock_directory_message(const StockDirectoryMessage &msg)
     std::cout << "  Inverse Indicator: " << (msg.inverse_indicator ? "Yes" : "No") << std::endl;
 }
 
-StockDirectoryMessage read_stock_directory_message(std::ifstream *fs, uint16_t length)
+StockDirectoryMessage parse_stock_directory_message(const char *message)
 {
-    assert(length == 38);
-
-    char *message = (char *)calloc(length, sizeof(char));
     StockDirectoryMessage parsed_message;
-
-    if (fs->read(message, length))
-    {
-        parsed_message.header = parse_header(&message[0]);
-        memcpy(&parsed_message.stock, &message[10], 8);
-        parsed_message.market_category = message[18];
-        parsed_message.financial_status_indicator = message[19];
-        parsed_message.round_lot_size = parse_uint32_t(&message[20]);
-        parsed_message.round_lots_only = (message[24] == 'Y');
-        parsed_message.issue_classification = message[25];
-        memcpy(&parsed_message.issue_sub_type, &message[26], 2);
-        parsed_message.authenticity = message[28];
-        parsed_message.short_sale_threshold = message[29];
-        parsed_message.ipo_flag = message[30];
-        parsed_message.luld_reference_price_tier = message[31];
-        parsed_message.etp_flag = message[32];
-        parsed_message.etp_leverage_factor = parse_uint32_t(&message[33]);
-        parsed_message.inverse_indicator = (message[37] == 'Y');
-    }
-
-    free(message);
+    parsed_message.header = parse_header(&message[0]);
+    memcpy(&parsed_message.stock, &message[10], 8);
+    parsed_message.market_category = message[18];
+    parsed_message.financial_status_indicator = message[19];
+    parsed_message.round_lot_size = parse_uint32_t(&message[20]);
+    parsed_message.round_lots_only = (message[24] == 'Y');
+    parsed_message.issue_classification = message[25];
+    memcpy(&parsed_message.issue_sub_type, &message[26], 2);
+    parsed_message.authenticity = message[28];
+    parsed_message.short_sale_threshold = message[29];
+    parsed_message.ipo_flag = message[30];
+    parsed_message.luld_reference_price_tier = message[31];
+    parsed_message.etp_flag = message[32];
+    parsed_message.etp_leverage_factor = parse_uint32_t(&message[33]);
+    parsed_message.inverse_indicator = (message[37] == 'Y');
     return parsed_message;
 }
 
@@ -299,22 +334,13 @@ void print_stock_trading_action_message(const StockTradingActionMessage &msg)
     std::cout << "  Reason: " << std::string(msg.reason, 4) << std::endl;
 }
 
-StockTradingActionMessage read_stock_trading_action_message(std::ifstream *fs, uint16_t length)
+StockTradingActionMessage parse_stock_trading_action_message(const char *message)
 {
-    assert(length == 24);
-
-    char *message = (char *)calloc(length, sizeof(char));
     StockTradingActionMessage parsed_message;
-
-    if (fs->read(message, length))
-    {
-        parsed_message.header = parse_header(&message[0]);
-        memcpy(&parsed_message.stock, &message[10], 8);
-        parsed_message.trading_state = message[18];
-        memcpy(&parsed_message.reason, &message[20], 4);
-    }
-
-    free(message);
+    parsed_message.header = parse_header(&message[0]);
+    memcpy(&parsed_message.stock, &message[10], 8);
+    parsed_message.trading_state = message[18];
+    memcpy(&parsed_message.reason, &message[20], 4);
     return parsed_message;
 }
 
@@ -326,21 +352,12 @@ void print_reg_sho_restriction(const RegSHORestriction &msg)
     std::cout << "  Reg SHO Action: " << msg.reg_sho_action << std::endl;
 }
 
-RegSHORestriction read_reg_sho_restriction(std::ifstream *fs, uint16_t length)
+RegSHORestriction parse_reg_sho_restriction(const char *message)
 {
-    assert(length == 19);
-
-    char *message = (char *)calloc(length, sizeof(char));
     RegSHORestriction parsed_message;
-
-    if (fs->read(message, length))
-    {
-        parsed_message.header = parse_header(&message[0]);
-        memcpy(&parsed_message.stock, &message[10], 8);
-        parsed_message.reg_sho_action = message[18];
-    }
-
-    free(message);
+    parsed_message.header = parse_header(&message[0]);
+    memcpy(&parsed_message.stock, &message[10], 8);
+    parsed_message.reg_sho_action = message[18];
     return parsed_message;
 }
 
@@ -355,23 +372,15 @@ void print_market_participant_position(const MarketParticipantPosition &msg)
     std::cout << "  Market Participant State: " << msg.market_participant_state << std::endl;
 }
 
-MarketParticipantPosition read_market_participant_position(std::ifstream *fs, uint16_t length)
+MarketParticipantPosition parse_market_participant_position(const char *message)
 {
-    assert(length == 25);
-    char *message = (char *)calloc(length, sizeof(char));
     MarketParticipantPosition parsed_message;
-
-    if (fs->read(message, length))
-    {
-        parsed_message.header = parse_header(&message[0]);
-        memcpy(&parsed_message.mpid, &message[10], 4);
-        memcpy(&parsed_message.stock, &message[14], 8);
-        parsed_message.primary_market_maker = (message[22] == 'Y');
-        parsed_message.market_maker_mode = message[23];
-        parsed_message.market_participant_state = message[24];
-    }
-
-    free(message);
+    parsed_message.header = parse_header(&message[0]);
+    memcpy(&parsed_message.mpid, &message[10], 4);
+    memcpy(&parsed_message.stock, &message[14], 8);
+    parsed_message.primary_market_maker = (message[22] == 'Y');
+    parsed_message.market_maker_mode = message[23];
+    parsed_message.market_participant_state = message[24];
     return parsed_message;
 }
 
@@ -387,31 +396,23 @@ void print_add_order_message(const AddOrderMessage &msg)
     std::cout << "  Attribution: " << std::string(msg.attribution, 4) << std::endl;
 }
 
-AddOrderMessage read_add_order_message(std::ifstream *fs, uint16_t length)
+AddOrderMessage parse_add_order_message(const char *message, uint16_t length)
 {
-    assert(length == 35 || length == 39);
-    char *message = (char *)calloc(length, sizeof(char));
     AddOrderMessage parsed_message;
-
-    if (fs->read(message, length))
+    parsed_message.header = parse_header(&message[0]);
+    parsed_message.order_reference_number = parse_uint64_t(&message[10]);
+    parsed_message.buy_sell_indicator = message[18];
+    parsed_message.shares = parse_uint32_t(&message[19]);
+    memcpy(&parsed_message.stock, &message[23], 8);
+    parsed_message.price = parse_price(&message[31]);
+    if (length == 39)
     {
-        parsed_message.header = parse_header(&message[0]);
-        parsed_message.order_reference_number = parse_uint64_t(&message[10]);
-        parsed_message.buy_sell_indicator = message[18];
-        parsed_message.shares = parse_uint32_t(&message[19]);
-        memcpy(&parsed_message.stock, &message[23], 8);
-        parsed_message.price = parse_uint32_t(&message[31]);
-        if (length == 39)
-        {
-            memcpy(&parsed_message.attribution, &message[35], 4);
-        }
-        else
-        {
-            memcpy(&parsed_message.attribution, &"NSDQ", 4);
-        }
+        memcpy(&parsed_message.attribution, &message[35], 4);
+    }
+    else
+    {
+        memcpy(&parsed_message.attribution, &"NSDQ", 4);
     }
-
-    free(message);
     return parsed_message;
 }
 
@@ -424,21 +425,13 @@ void print_delete_cancel_message(const DeleteCancelMessage &msg)
     std::cout << "  Cancelled Shares: " << std::dec << msg.cancelled_shares << std::endl;
 }
 
-DeleteCancelMessage read_delete_cancel_message(std::ifstream *fs, uint16_t length)
+DeleteCancelMessage parse_delete_cancel_message(const char *message, uint16_t length)
 {
-    assert(length == 22 || length == 18);
-    char *message = (char *)calloc(length, sizeof(char));
     DeleteCancelMessage parsed_message;
-
-    if (fs->read(message, length))
-    {
-        parsed_message.header = parse_header(&message[0]);
-        parsed_message.order_reference_number = parse_uint64_t(&message[10]);
-        parsed_message.delete_cancel_indicator = (length == 22) ? 'C' : 'D';
-        parsed_message.cancelled_shares = (length == 22) ? parse_uint32_t(&message[18]) : 0;
-    }
-
-    free(message);
+    parsed_message.header = parse_header(&message[0]);
+    parsed_message.order_reference_number = parse_uint64_t(&message[10]);
+    parsed_message.delete_cancel_indicator = (length == 22) ? 'C' : 'D';
+    parsed_message.cancelled_shares = (length == 22) ? parse_uint32_t(&message[18]) : 0;
     return parsed_message;
 }
 
@@ -452,22 +445,14 @@ void print_replace_order_message(const ReplaceOrderMessage &msg)
     std::cout << "  Price: " << std::dec << msg.price << std::endl;
 }
 
-ReplaceOrderMessage read_replace_order_message(std::ifstream *fs, uint16_t length)
+ReplaceOrderMessage parse_replace_order_message(const char *message)
 {
-    assert(length == 34);
-    char *message = (char *)calloc(length, sizeof(char));
     ReplaceOrderMessage parsed_message;
-
-    if (fs->read(message, length))
-    {
-        parsed_message.header = parse_header(&message[0]);
-        parsed_message.original_order_reference_number = parse_uint64_t(&message[10]);
-        parsed_message.new_order_reference_number = parse_uint64_t(&message[18]);
-        parsed_message.shares = parse_uint32_t(&message[26]);
-        parsed_message.price = parse_uint32_t(&message[30]);
-    }
-
-    free(message);
+    parsed_message.header = parse_header(&message[0]);
+    parsed_message.original_order_reference_number = parse_uint64_t(&message[10]);
+    parsed_message.new_order_reference_number = parse_uint64_t(&message[18]);
+    parsed_message.shares = parse_uint32_t(&message[26]);
+    parsed_message.price = parse_price(&message[30]);
     return parsed_message;
 }
 
@@ -480,21 +465,13 @@ void print_order_executed_message(const OrderExecutedMessage &msg)
     std::cout << "  Match Number: " << std::dec << msg.match_number << std::endl;
 }
 
-OrderExecutedMessage read_order_executed_message(std::ifstream *fs, uint16_t length)
+OrderExecutedMessage parse_order_executed_message(const char *message)
 {
-    assert(length == 30);
-    char *message = (char *)calloc(length, sizeof(char));
     OrderExecutedMessage parsed_message;
-
-    if (fs->read(message, length))
-    {
-        parsed_message.header = parse_header(&message[0]);
-        parsed_message.order_reference_number = parse_uint64_t(&message[10]);
-        parsed_message.executed_shares = parse_uint32_t(&message[18]);
-        parsed_message.match_number = parse_uint64_t(&message[22]);
-    }
-
-    free(message);
+    parsed_message.header = parse_header(&message[0]);
+    parsed_message.order_reference_number = parse_uint64_t(&message[10]);
+    parsed_message.executed_shares = parse_uint32_t(&message[18]);
+    parsed_message.match_number = parse_uint64_t(&message[22]);
     return parsed_message;
 }
 
@@ -509,23 +486,15 @@ void print_order_executed_price_message(const OrderExecutedPriceMessage &msg)
     std::cout << "  Execution Price: " << std::dec << msg.execution_price << std::endl;
 }
 
-OrderExecutedPriceMessage read_order_executed_price_message(std::ifstream *fs, uint16_t length)
+OrderExecutedPriceMessage parse_order_executed_price_message(const char *message)
 {
-    assert(length == 35);
-    char *message = (char *)calloc(length, sizeof(char));
     OrderExecutedPriceMessage parsed_message;
-
-    if (fs->read(message, length))
-    {
-        parsed_message.header = parse_header(&message[0]);
-        parsed_message.order_reference_number = parse_uint64_t(&message[10]);
-        parsed_message.executed_shares = parse_uint32_t(&message[18]);
-        parsed_message.match_number = parse_uint64_t(&message[22]);
-        parsed_message.printable = (message[30] == 'Y');
-        parsed_message.execution_price = parse_uint32_t(&message[31]);
-    }
-
-    free(message);
+    parsed_message.header = parse_header(&message[0]);
+    parsed_message.order_reference_number = parse_uint64_t(&message[10]);
+    parsed_message.executed_shares = parse_uint32_t(&message[18]);
+    parsed_message.match_number = parse_uint64_t(&message[22]);
+    parsed_message.printable = (message[30] == 'Y');
+    parsed_message.execution_price = parse_price(&message[31]);
     return parsed_message;
 }
 
@@ -539,22 +508,14 @@ void print_trade_non_cross_message(const TradeNonCrossMessage &msg)
     std::cout << "  Match Number: " << std::dec << msg.match_number << std::endl;
 }
 
-TradeNonCrossMessage read_trade_non_cross_message(std::ifstream *fs, uint16_t length)
+TradeNonCrossMessage parse_trade_non_cross_message(const char *message)
 {
-    assert(length == 43);
-    char *message = (char *)calloc(length, sizeof(char));
     TradeNonCrossMessage parsed_message;
-
-    if (fs->read(message, length))
-    {
-        parsed_message.header = parse_header(&message[0]);
-        parsed_message.shares = parse_uint32_t(&message[19]);
-        memcpy(&parsed_message.stock, &message[23], 8);
-        parsed_message.price = parse_uint32_t(&message[31]);
-        parsed_message.match_number = parse_uint64_t(&message[35]);
-    }
-
-    free(message);
+    parsed_message.header = parse_header(&message[0]);
+    parsed_message.shares = parse_uint32_t(&message[19]);
+    memcpy(&parsed_message.stock, &message[23], 8);
+    parsed_message.price = parse_price(&message[31]);
+    parsed_message.match_number = parse_uint64_t(&message[35]);
     return parsed_message;
 }
 
@@ -569,22 +530,174 @@ void print_trade_non_cross_message(const TradeCrossMessage &msg)
     std::cout << "  Cross Type: " << std::dec << msg.cross_type << std::endl;
 }
 
-TradeCrossMessage read_trade_cross_message(std::ifstream *fs, uint16_t length)
+TradeCrossMessage parse_trade_cross_message(const char *message)
 {
-    assert(length == 39);
-    char *message = (char *)calloc(length, sizeof(char));
     TradeCrossMessage parsed_message;
+    parsed_message.header = parse_header(&message[0]);
+    parsed_message.shares = parse_uint64_t(&message[10]);
+    memcpy(&parsed_message.stock, &message[18], 8);
+    parsed_message.cross_price = parse_price(&message[26]);
+    parsed_message.match_number = parse_uint64_t(&message[30]);
+    parsed_message.cross_type = message[38];
+    return parsed_message;
+}
 
-    if (fs->read(message, length))
-    {
-        parsed_message.header = parse_header(&message[0]);
-        parsed_message.shares = parse_uint32_t(&message[10]);
-        memcpy(&parsed_message.stock, &message[18], 8);
-        parsed_message.cross_price = parse_uint32_t(&message[26]);
-        parsed_message.match_number = parse_uint64_t(&message[30]);
-        parsed_message.cross_type = message[38];
-    }
+void print_mwcb_decline_message(const MWCBDeclineMessage &msg)
+{
+    std::cout << "MWCB Decline Level Message:" << std::endl;
+    print_header(msg.header);
+    std::cout << "  Level 1: " << std::dec << msg.level_1 << std::endl;
+    std::cout << "  Level 2: " << std::dec << msg.level_2 << std::endl;
+    std::cout << "  Level 3: " << std::dec << msg.level_3 << std::endl;
+}
+
+MWCBDeclineMessage parse_mwcb_decline_message(const char *message)
+{
+    MWCBDeclineMessage parsed_message;
+    parsed_message.header = parse_header(&message[0]);
+    parsed_message.level_1 = parse_uint64_t(&message[10]);
+    parsed_message.level_2 = parse_uint64_t(&message[18]);
+    parsed_message.level_3 = parse_uint64_t(&message[26]);
+    return parsed_message;
+}
+
+void print_ipo_quoting_period_message(const IPOQuotingPeriodMessage &msg)
+{
+    std::cout << "IPO Quoting Period Update Message:" << std::endl;
+    print_header(msg.header);
+    std::cout << "  Stock: " << std::string(msg.stock, 8) << std::endl;
+    std::cout << "  IPO Quotation Release Time: " << std::dec << msg.ipo_quotation_release_time << std::endl;
+    std::cout << "  IPO Quotation Release Qualifier: " << msg.ipo_quotation_release_qualifier << std::endl;
+    std::cout << "  IPO Price: " << std::dec << msg.ipo_price << std::endl;
+}
+
+IPOQuotingPeriodMessage parse_ipo_quoting_period_message(const char *message)
+{
+    IPOQuotingPeriodMessage parsed_message;
+    parsed_message.header = parse_header(&message[0]);
+    memcpy(&parsed_message.stock, &message[10], 8);
+    parsed_message.ipo_quotation_release_time = parse_uint32_t(&message[18]);
+    parsed_message.ipo_quotation_release_qualifier = message[22];
+    parsed_message.ipo_price = parse_price(&message[23]);
+    return parsed_message;
+}
+
+void print_noii_message(const NOIIMessage &msg)
+{
+    std::cout << "NOII Message:" << std::endl;
+    print_header(msg.header);
+    std::cout << "  Paired Shares: " << std::dec << msg.paired_shares << std::endl;
+    std::cout << "  Imbalance Shares: " << std::dec << msg.imbalance_shares << std::endl;
+    std::cout << "  Imbalance Direction: " << msg.imbalance_direction << std::endl;
+    std::cout << "  Stock: " << std::string(msg.stock, 8) << std::endl;
+    std::cout << "  Far Price: " << std::dec << msg.far_price << std::endl;
+    std::cout << "  Near Price: " << std::dec << msg.near_price << std::endl;
+    std::cout << "  Current Reference Price: " << std::dec << msg.current_reference_price << std::endl;
+    std::cout << "  Cross Type: " << msg.cross_type << std::endl;
+    std::cout << "  Price Variation Indicator: " << msg.price_variation_indicator << std::endl;
+}
+
+NOIIMessage parse_noii_message(const char *message)
+{
+    NOIIMessage parsed_message;
+    parsed_message.header = parse_header(&message[0]);
+    parsed_message.paired_shares = parse_uint64_t(&message[10]);
+    parsed_message.imbalance_shares = parse_uint64_t(&message[18]);
+    parsed_message.imbalance_direction = message[26];
+    memcpy(&parsed_message.stock, &message[27], 8);
+    parsed_message.far_price = parse_price(&message[35]);
+    parsed_message.near_price = parse_price(&message[39]);
+    parsed_message.current_reference_price = parse_price(&message[43]);
+    parsed_message.cross_type = message[47];
+    parsed_message.price_variation_indicator = message[48];
+    return parsed_message;
+}
+
+void print_luld_auction_collar_message(const LULDAuctionCollarMessage &msg)
+{
+    std::cout << "LULD Auction Collar Message:" << std::endl;
+    print_header(msg.header);
+    std::cout << "  Stock: " << std::string(msg.stock, 8) << std::endl;
+    std::cout << "  Auction Collar Reference Price: " << std::dec << msg.auction_collar_reference_price << std::endl;
+    std::cout << "  Upper Auction Collar Price: " << std::dec << msg.upper_auction_collar_price << std::endl;
+    std::cout << "  Lower Auction Collar Price: " << std::dec << msg.lower_auction_collar_price << std::endl;
+    std::cout << "  Auction Collar Extension: " << std::dec << msg.auction_collar_extension << std::endl;
+}
 
-    free(message);
+LULDAuctionCollarMessage parse_luld_auction_collar_message(const char *message)
+{
+    LULDAuctionCollarMessage parsed_message;
+    parsed_message.header = parse_header(&message[0]);
+    memcpy(&parsed_message.stock, &message[10], 8);
+    parsed_message.auction_collar_reference_price = parse_price(&message[18]);
+    parsed_message.upper_auction_collar_price = parse_price(&message[22]);
+    parsed_message.lower_auction_collar_price = parse_price(&message[26]);
+    parsed_message.auction_collar_extension = parse_uint32_t(&message[30]);
     return parsed_message;
-}
\ No newline at end of file
+}
+
+void print_broken_trade_message(const BrokenTradeMessage &msg)
+{
+    std::cout << "Broken Trade Message:" << std::endl;
+    print_header(msg.header);
+    std::cout << "  Match Number: " << std::dec << msg.match_number << std::endl;
+}
+
+BrokenTradeMessage parse_broken_trade_message(const char *message)
+{
+    BrokenTradeMessage parsed_message;
+    parsed_message.header = parse_header(&message[0]);
+    parsed_message.match_number = parse_uint64_t(&message[10]);
+    return parsed_message;
+}
+
+void print_mwcb_status_message(const MWCBStatusMessage &msg)
+{
+    std::cout << "MWCB Status Message:" << std::endl;
+    print_header(msg.header);
+    std::cout << "  Breached Level: " << msg.breached_level << std::endl;
+}
+
+MWCBStatusMessage parse_mwcb_status_message(const char *message)
+{
+    MWCBStatusMessage parsed_message;
+    parsed_message.header = parse_header(&message[0]);
+    parsed_message.breached_level = message[10];
+    return parsed_message;
+}
+
+void print_rpii_message(const RPIIMessage &msg)
+{
+    std::cout << "RPII Message:" << std::endl;
+    print_header(msg.header);
+    std::cout << "  Stock: " << std::string(msg.stock, 8) << std::endl;
+    std::cout << "  Interest Flag: " << msg.interest_flag << std::endl;
+}
+
+RPIIMessage parse_rpii_message(const char *message)
+{
+    RPIIMessage parsed_message;
+    parsed_message.header = parse_header(&message[0]);
+    memcpy(&parsed_message.stock, &message[10], 8);
+    parsed_message.interest_flag = message[18];
+    return parsed_message;
+}
+
+void print_operational_halt_message(const OperationalHaltMessage &msg)
+{
+    std::cout << "Operational Halt Message:" << std::endl;
+    print_header(msg.header);
+    std::cout << "  Stock: " << std::string(msg.stock, 8) << std::endl;
+    std::cout << "  Market Code: " << msg.market_code << std::endl;
+    std::cout << "  Operational Halt Action: " << msg.operational_halt_action << std::endl;
+}
+
+OperationalHaltMessage parse_operational_halt_message(const char *message)
+{
+    OperationalHaltMessage parsed_message;
+    parsed_message.header = parse_header(&message[0]);
+    memcpy(&parsed_message.stock, &message[10], 8);
+    parsed_message.market_code = message[18];
+    parsed_message.operational_halt_action = message[19];
+    return parsed_message;
+}
@@ -4,6 +4,8 @@
 #include <iostream>
 #include <fstream>
 #include <cstring>
+#include <cstdint>
+#include "price.h"
 
 enum class MessageType
 {
@@ -23,6 +25,10 @@ enum class MessageType
     IPO_QUOTING_PERIOD,
     NOII_MESSAGE,
     LULD_AUCTION_COLLAR,
+    BROKEN_TRADE_MESSAGE,
+    MWCB_STATUS_MESSAGE,
+    RPII_MESSAGE,
+    OPERATIONAL_HALT_MESSAGE,
     UNKNOWN_MESSAGE
 };
 
@@ -90,7 +96,7 @@ struct AddOrderMessage
     char buy_sell_indicator;
     uint32_t shares;
     char stock[8];
-    uint32_t price;
+    Price price;
     char attribution[4];
 };
 
@@ -108,7 +114,7 @@ struct ReplaceOrderMessage
     uint64_t original_order_reference_number;
     uint64_t new_order_reference_number;
     uint32_t shares;
-    uint32_t price;
+    Price price;
 };
 
 struct OrderExecutedMessage
@@ -126,7 +132,7 @@ struct OrderExecutedPriceMessage
     uint32_t executed_shares;
     uint64_t match_number;
     bool printable;
-    uint32_t execution_price;
+    Price execution_price;
 };
 
 struct TradeNonCrossMessage
@@ -134,50 +140,173 @@ struct TradeNonCrossMessage
     Header header;
     uint32_t shares;
     char stock[8];
-    uint32_t price;
+    Price price;
     uint64_t match_number;
 };
 
 struct TradeCrossMessage
 {
     Header header;
-    uint32_t shares;
+    uint64_t shares;
     char stock[8];
-    uint32_t cross_price;
+    Price cross_price;
     uint64_t match_number;
     char cross_type;
 };
 
+struct MWCBDeclineMessage
+{
+    Header header;
+    uint64_t level_1;
+    uint64_t level_2;
+    uint64_t level_3;
+};
+
+struct IPOQuotingPeriodMessage
+{
+    Header header;
+    char stock[8];
+    uint32_t ipo_quotation_release_time;
+    char ipo_quotation_release_qualifier;
+    Price ipo_price;
+};
+
+struct NOIIMessage
+{
+    Header header;
+    uint64_t paired_shares;
+    uint64_t imbalance_shares;
+    char imbalance_direction;
+    char stock[8];
+    Price far_price;
+    Price near_price;
+    Price current_reference_price;
+    char cross_type;
+    char price_variation_indicator;
+};
+
+struct LULDAuctionCollarMessage
+{
+    Header header;
+    char stock[8];
+    Price auction_collar_reference_price;
+    Price upper_auction_collar_price;
+    Price lower_auction_collar_price;
+    uint32_t auction_collar_extension;
+};
+
+struct BrokenTradeMessage
+{
+    Header header;
+    uint64_t match_number;
+};
+
+struct MWCBStatusMessage
+{
+    Header header;
+    char breached_level;
+};
+
+struct RPIIMessage
+{
+    Header header;
+    char stock[8];
+    char interest_flag;
+};
+
+struct OperationalHaltMessage
+{
+    Header header;
+    char stock[8];
+    char market_code;
+    char operational_halt_action;
+};
+
+// Frames carry a 2 byte big-endian length, so no frame can be longer than this.
+constexpr size_t MAX_FRAME_LENGTH = UINT16_MAX;
+
+enum class FrameStatus
+{
+    OK,
+    END_OF_FEED,
+    TRUNCATED,
+    // The source failed (an I/O error or corrupt compressed data) before the end of the feed.
+    READ_ERROR
+};
+
 std::ostream &operator<<(std::ostream &os, MessageType type);
 
-uint16_t read_length(std::ifstream *fs);
+#ifdef ITCH_INLINE_DECODE
+#include "decode.h"
+#else
+uint16_t parse_uint16_t(const char *x_char);
+
+uint32_t parse_uint32_t(const char *x_char);
+Price parse_price(const char *x_char);
+
+uint64_t parse_uint64_t(const char *x_char);
+
+uint64_t parse_timestamp(const char *timestamp_char);
+
+Header parse_header(const char *message);
+#endif
+
+std::string format_timestamp(const uint64_t timestamp_ns);
+
+// Parses HH:MM[:SS[.fraction]] into nanoseconds since midnight, the ITCH
+// timestamp scale. Returns false if text is not a valid time of day.
+bool parse_time_of_day(const std::string &text, uint64_t &timestamp_ns);
+
+// Parses a decimal command line count. Returns false unless all of text is
+// digits and the value is at most max_value.
+bool parse_unsigned(const std::string &text, uint64_t max_value, uint64_t &value);
+
+MessageType get_message_type(char message_type);
+
+// Body length (excluding the type byte) the spec defines for message_type, 0 if it is not a known type.
+uint16_t expected_message_length(char message_type);
+
+SystemEventMessage parse_system_event_message(const char *message);
+
+StockDirectoryMessage parse_stock_directory_message(const char *message);
+
+StockTradingActionMessage parse_stock_trading_action_message(const char *message);
+
+RegSHORestriction parse_reg_sho_restriction(const char *message);
+
+MarketParticipantPosition parse_market_participant_position(const char *message);
+
+// The decoders take the body after the type byte, whose length the caller has
+// already checked against expected_message_length. Only add order and
+// delete/cancel take the length too, to tell 'F' from 'A' and a cancel ('X') from a delete ('D').
+AddOrderMessage parse_add_order_message(const char *message, uint16_t length);
 
-void dummy_read(std::ifstream *fs, uint32_t length);
+DeleteCancelMessage parse_delete_cancel_message(const char *message, uint16_t length);
 
-MessageType read_message_type(std::ifstream *fs);
+ReplaceOrderMessage parse_replace_order_message(const char *message);
 
-SystemEventMessage read_system_event_message(std::ifstream *fs, uint16_t length);
+OrderExecutedMessage parse_order_executed_message(const char *message);
 
-StockDirectoryMessage read_stock_directory_message(std::ifstream *fs, uint16_t length);
+OrderExecutedPriceMessage parse_order_executed_price_message(const char *message);
 
-StockTradingActionMessage read_stock_trading_action_message(std::ifstream *fs, uint16_t length);
+TradeNonCrossMessage parse_trade_non_cross_message(const char *message);
 
-RegSHORestriction read_reg_sho_restriction(std::ifstream *fs, uint16_t length);
+TradeCrossMessage parse_trade_cross_message(const char *message);
 
-MarketParticipantPosition read_market_participant_position(std::ifstream *fs, uint16_t length);
+MWCBDeclineMessage parse_mwcb_decline_message(const char *message);
 
-AddOrderMessage read_add_order_message(std::ifstream *fs, uint16_t length);
+IPOQuotingPeriodMessage parse_ipo_quoting_period_message(const char *message);
 
-DeleteCancelMessage read_delete_cancel_message(std::ifstream *fs, uint16_t length);
+NOIIMessage parse_noii_message(const char *message);
 
-ReplaceOrderMessage read_replace_order_message(std::ifstream *fs, uint16_t length);
+LULDAuctionCollarMessage parse_luld_auction_collar_message(const char *message);
 
-OrderExecutedMessage read_order_executed_message(std::ifstream *fs, uint16_t length);
+BrokenTradeMessage parse_broken_trade_message(const char *message);
 
-OrderExecutedPriceMessage read_order_executed_price_message(std::ifstream *fs, uint16_t length);
+MWCBStatusMessage parse_mwcb_status_message(const char *message);
 
-TradeNonCrossMessage read_trade_non_cross_message(std::ifstream *fs, uint16_t length);
+RPIIMessage parse_rpii_message(const char *message);
 
-TradeCrossMessage read_trade_cross_message(std::ifstream *fs, uint16_t length);
+OperationalHaltMessage parse_operational_halt_message(const char *message);
 
 #endif // HELPER_H
\ No newline at end of file
@@ -3,7 +3,6 @@
 
 #include <iostream>
 #include <unordered_map>
-#include <cassert>
 #include "helper.h"
 using namespace std;
 
@@ -26,67 +25,176 @@ struct InstrumentTableEntry
     char trading_state;
     char reason[4];
     char reg_sho_action;
+    char retail_interest_flag;
+    char operational_halt_action;
+    // Loaded from a reference cache and not yet confirmed by the day's stock directory message.
+    bool cached;
+};
+
+// How the day's stock directory messages compared with a preloaded reference cache.
+struct ReferenceCacheCheck
+{
+    uint64_t loaded;
+    uint64_t confirmed;
+    // The day's message changed the cached entry for the stock_locate.
+    uint64_t changed;
+    // Stock directory messages for a stock_locate the cache did not have.
+    uint64_t added;
 };
 
 class InstrumentTable
 {
 
 public:
-    void add_to_instrument_table(const StockDirectoryMessage &message)
+    // The add_* methods return false when the message contradicts the table
+    // (duplicate or unknown stock_locate, or a symbol that does not match it).
+    //
+    // With a reference cache loaded, the stock directory message validates the
+    // cached entry instead: a matching entry is confirmed, and one that differs
+    // (stock_locates are reassigned from day to day) is replaced by the message.
+    bool add_to_instrument_table(const StockDirectoryMessage &message)
+    {
+        uint16_t stock_locate = message.header.stock_locate;
+        string stock = string(message.stock, 8);
+
+        InstrumentTableEntry entry = {};
+        entry.stock = stock;
+        entry.market_category = message.market_category;
+        entry.financial_status_indicator = message.financial_status_indicator;
+        entry.round_lot_size = message.round_lot_size;
+        entry.round_lots_only = message.round_lots_only;
+        entry.issue_classification = message.issue_classification;
+        memcpy(&entry.issue_sub_type, &message.issue_sub_type, sizeof(entry.issue_sub_type));
+        entry.authenticity = message.authenticity;
+        entry.short_sale_threshold = message.short_sale_threshold;
+        entry.ipo_flag = message.ipo_flag;
+        entry.luld_reference_price_tier = message.luld_reference_price_tier;
+        entry.etp_flag = message.etp_flag;
+        entry.etp_leverage_factor = message.etp_leverage_factor;
+        entry.inverse_indicator = message.inverse_indicator;
+
+        auto it = instrument_table.find(stock_locate);
+        if (it != instrument_table.end() && !it->second.cached)
+        {
+            std::cout << "Duplicate stock locate: " << std::dec << stock_locate << "for: " << message.stock << std::endl;
+            return false;
+        }
+        if (it != instrument_table.end())
+        {
+            if (same_directory_fields(it->second, entry))
+            {
+                it->second.cached = false;
+                cache_check.confirmed++;
+                return true;
+            }
+            cache_check.changed++;
+            remove_entry(stock_locate);
+        }
+        else if (cache_check.loaded > 0)
+        {
+            cache_check.added++;
+        }
+
+        // A symbol that moved to another stock_locate leaves its unconfirmed cached entry behind.
+        auto previous = stock_to_stock_locate_map.find(stock);
+        if (previous != stock_to_stock_locate_map.end() && instrument_table[previous->second].cached)
+        {
+            remove_entry(previous->second);
+        }
+
+        stock_locate_to_stock_map[stock_locate] = stock;
+        stock_to_stock_locate_map[stock] = stock_locate;
+        instrument_table[stock_locate] = entry;
+        return true;
+    }
+
+    // Preloads an entry from a reference cache; the day's stock directory message later confirms or replaces it.
+    void add_cached_entry(uint16_t stock_locate, const InstrumentTableEntry &entry)
+    {
+        remove_entry(stock_locate);
+        stock_locate_to_stock_map[stock_locate] = entry.stock;
+        stock_to_stock_locate_map[entry.stock] = stock_locate;
+        instrument_table[stock_locate] = entry;
+        instrument_table[stock_locate].cached = true;
+        cache_check.loaded++;
+    }
+
+    const ReferenceCacheCheck &reference_cache_check() const
+    {
+        return cache_check;
+    }
+
+    // Calls function(stock_locate, entry) for every stock, in no particular order.
+    template <typename Function>
+    void for_each_entry(Function function) const
+    {
+        for (const auto &[stock_locate, entry] : instrument_table)
+        {
+            function(stock_locate, entry);
+        }
+    }
+
+    bool add_stock_trading_action_message(const StockTradingActionMessage &message)
+    {
+        InstrumentTableEntry *entry = find_entry(message.header.stock_locate, message.stock);
+        if (entry == nullptr)
+        {
+            return false;
+        }
+        entry->trading_state = message.trading_state;
+        memcpy(&entry->reason, &message.reason, 4);
+        return true;
+    }
+
+    bool add_reg_sho_restriction(const RegSHORestriction &message)
     {
-        if (stock_locate_to_stock_map.find(message.header.stock_locate) != stock_locate_to_stock_map.end())
+        InstrumentTableEntry *entry = find_entry(message.header.stock_locate, message.stock);
+        if (entry == nullptr)
         {
-            std::cout << "Duplicate stock locate: " << std::dec << message.header.stock_locate << "for: " << message.stock << std::endl;
+            return false;
         }
-        else
+        entry->reg_sho_action = message.reg_sho_action;
+        return true;
+    }
+
+    bool add_rpii_message(const RPIIMessage &message)
+    {
+        InstrumentTableEntry *entry = find_entry(message.header.stock_locate, message.stock);
+        if (entry == nullptr)
         {
-            string stock = string(message.stock, 8);
-            stock_locate_to_stock_map[message.header.stock_locate] = stock;
-            stock_to_stock_locate_map[stock] = message.header.stock_locate;
-
-            InstrumentTableEntry entry;
-            entry.stock = stock;
-            entry.market_category = message.market_category;
-            entry.financial_status_indicator = message.financial_status_indicator;
-            entry.round_lot_size = message.round_lot_size;
-            entry.round_lots_only = message.round_lots_only;
-            entry.issue_classification = message.issue_classification;
-            memcpy(&entry.issue_sub_type, &message.issue_sub_type, sizeof(entry.issue_sub_type));
-            entry.authenticity = message.authenticity;
-            entry.short_sale_threshold = message.short_sale_threshold;
-            entry.ipo_flag = message.ipo_flag;
-            entry.luld_reference_price_tier = message.luld_reference_price_tier;
-            entry.etp_flag = message.etp_flag;
-            entry.etp_leverage_factor = message.etp_leverage_factor;
-            entry.inverse_indicator = message.inverse_indicator;
-            instrument_table[message.header.stock_locate] = entry;
+            return false;
         }
+        entry->retail_interest_flag = message.interest_flag;
+        return true;
     }
 
-    void add_stock_trading_action_message(const StockTradingActionMessage &message)
+    bool add_operational_halt_message(const OperationalHaltMessage &message)
     {
-        assert(stock_locate_to_stock_map.find(message.header.stock_locate) != stock_locate_to_stock_map.end());
-        assert(stock_locate_to_stock_map[message.header.stock_locate] == string(message.stock, 8));
-        instrument_table[message.header.stock_locate].trading_state = message.trading_state;
-        memcpy(&instrument_table[message.header.stock_locate].reason, &message.reason, 4);
+        InstrumentTableEntry *entry = find_entry(message.header.stock_locate, message.stock);
+        if (entry == nullptr)
+        {
+            return false;
+        }
+        entry->operational_halt_action = message.operational_halt_action;
+        return true;
     }
 
-    void add_reg_sho_restriction(const RegSHORestriction &message)
+    // Trading state from the last trading action message, or 0 if none was received.
+    char get_trading_state(uint16_t stock_locate) const
     {
-        assert(stock_locate_to_stock_map.find(message.header.stock_locate) != stock_locate_to_stock_map.end());
-        assert(stock_locate_to_stock_map[message.header.stock_locate] == string(message.stock, 8));
-        instrument_table[message.header.stock_locate].reg_sho_action = message.reg_sho_action;
+        auto it = instrument_table.find(stock_locate);
+        return (it == instrument_table.end()) ? 0 : it->second.trading_state;
     }
 
     void print_instrument_table()
     {
-        for (const auto pair : stock_locate_to_stock_map)
+        for (const auto &pair : stock_locate_to_stock_map)
         {
             std::cout << "Stock Locate: " << pair.first
                       << " | Stock: " << pair.second << std::endl;
         }
 
-        for (const auto [key, entry] : instrument_table)
+        for (const auto &[key, entry] : instrument_table)
         {
             std::cout << key << ",";
             print_instrument_table_entry(entry);
@@ -98,15 +206,74 @@ public:
         return stock_to_stock_locate_map[stock];
     }
 
+    // 0, which no stock uses, if the symbol (padded to 8 characters) is not in the table.
+    uint16_t find_stock_locate(const string &stock) const
+    {
+        auto it = stock_to_stock_locate_map.find(stock);
+        return (it == stock_to_stock_locate_map.end()) ? 0 : it->second;
+    }
+
     string get_stock_from_stock_locate(const uint16_t stock_locate)
     {
         return stock_locate_to_stock_map[stock_locate];
     }
 
+    // nullptr if no stock directory message was seen for the stock_locate.
+    const InstrumentTableEntry *get_entry(uint16_t stock_locate) const
+    {
+        auto it = instrument_table.find(stock_locate);
+        return (it == instrument_table.end()) ? nullptr : &it->second;
+    }
+
 private:
     unordered_map<uint16_t, string> stock_locate_to_stock_map;
     unordered_map<string, uint16_t> stock_to_stock_locate_map;
     unordered_map<uint16_t, InstrumentTableEntry> instrument_table;
+    ReferenceCacheCheck cache_check = {};
+
+    static bool same_directory_fields(const InstrumentTableEntry &a, const InstrumentTableEntry &b)
+    {
+        return a.stock == b.stock &&
+               a.market_category == b.market_category &&
+               a.financial_status_indicator == b.financial_status_indicator &&
+               a.round_lot_size == b.round_lot_size &&
+               a.round_lots_only == b.round_lots_only &&
+               a.issue_classification == b.issue_classification &&
+               memcmp(a.issue_sub_type, b.issue_sub_type, sizeof(a.issue_sub_type)) == 0 &&
+               a.authenticity == b.authenticity &&
+               a.short_sale_threshold == b.short_sale_threshold &&
+               a.ipo_flag == b.ipo_flag &&
+               a.luld_reference_price_tier == b.luld_reference_price_tier &&
+               a.etp_flag == b.etp_flag &&
+               a.etp_leverage_factor == b.etp_leverage_factor &&
+               a.inverse_indicator == b.inverse_indicator;
+    }
+
+    void remove_entry(uint16_t stock_locate)
+    {
+        auto it = stock_locate_to_stock_map.find(stock_locate);
+        if (it == stock_locate_to_stock_map.end())
+        {
+            return;
+        }
+        auto reverse = stock_to_stock_locate_map.find(it->second);
+        if (reverse != stock_to_stock_locate_map.end() && reverse->second == stock_locate)
+        {
+            stock_to_stock_locate_map.erase(reverse);
+        }
+        stock_locate_to_stock_map.erase(it);
+        instrument_table.erase(stock_locate);
+    }
+
+    InstrumentTableEntry *find_entry(uint16_t stock_locate, const char *stock)
+    {
+        auto it = instrument_table.find(stock_locate);
+        if (it == instrument_table.end() || it->second.stock.compare(0, 8, stock, 8) != 0)
+        {
+            return nullptr;
+        }
+        return &it->second;
+    }
 
     void print_instrument_table_entry(const InstrumentTableEntry &entry)
     {
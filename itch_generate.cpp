@@ -0,0 +1,380 @@
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+using namespace std;
+
+// Writes a synthetic ITCH 5.0 capture: a stock directory, a trading day of
+// system events and a random order flow over a few hundred stocks with roughly
+// the message mix of a NASDAQ day (adds, cancels, executions and replaces
+// dominate), with the occasional halt that ends in a quotation period and a
+// halt cross. Every order event references a live order, so the file replays
+// without book errors. It is used to train the PGO build and for benchmarks.
+//
+//     itch_generate <output> [messages] [seed]
+
+constexpr uint32_t STOCKS = 256;
+constexpr uint64_t MARKET_OPEN_NS = 34200ull * 1000000000ull;
+constexpr uint64_t MARKET_CLOSE_NS = 57600ull * 1000000000ull;
+// A stock is halted every HALT_INTERVAL messages and re-opens HALT_LENGTH messages later.
+constexpr uint64_t HALT_INTERVAL = 250000;
+constexpr uint64_t HALT_LENGTH = 20000;
+
+struct LiveOrder
+{
+    uint16_t stock_locate;
+    char side;
+    uint32_t price;
+    uint32_t shares;
+};
+
+class FeedWriter
+{
+public:
+    explicit FeedWriter(const string &path) : file(path, std::ios::binary)
+    {
+    }
+
+    bool ok() const
+    {
+        return (bool)file;
+    }
+
+    void begin(char type, uint16_t stock_locate, uint64_t timestamp)
+    {
+        frame.clear();
+        frame.push_back(type);
+        put_u16(stock_locate);
+        put_u16(0);
+        for (int shift = 40; shift >= 0; shift -= 8)
+        {
+            frame.push_back((char)(timestamp >> shift));
+        }
+    }
+
+    void put_char(char c)
+    {
+        frame.push_back(c);
+    }
+
+    void put_text(const string &text, size_t width)
+    {
+        for (size_t i = 0; i < width; i++)
+        {
+            frame.push_back(i < text.size() ? text[i] : ' ');
+        }
+    }
+
+    void put_u16(uint16_t x)
+    {
+        put_be(x, 2);
+    }
+
+    void put_u32(uint32_t x)
+    {
+        put_be(x, 4);
+    }
+
+    void put_u64(uint64_t x)
+    {
+        put_be(x, 8);
+    }
+
+    void end()
+    {
+        char length[2] = {(char)(frame.size() >> 8), (char)frame.size()};
+        file.write(length, 2);
+        file.write(frame.data(), frame.size());
+    }
+
+private:
+    std::ofstream file;
+    vector<char> frame;
+
+    void put_be(uint64_t x, int bytes)
+    {
+        for (int shift = (bytes - 1) * 8; shift >= 0; shift -= 8)
+        {
+            frame.push_back((char)(x >> shift));
+        }
+    }
+};
+
+static string symbol_name(uint32_t index)
+{
+    string symbol;
+    do
+    {
+        symbol.push_back((char)('A' + index % 26));
+        index /= 26;
+    } while (index > 0);
+    return "S" + symbol;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        cerr << "Usage: " << argv[0] << " <output> [messages] [seed]" << endl;
+        return 1;
+    }
+    uint64_t messages = (argc > 2) ? strtoull(argv[2], nullptr, 10) : 5000000;
+    uint64_t seed = (argc > 3) ? strtoull(argv[3], nullptr, 10) : 1;
+
+    FeedWriter out(argv[1]);
+    if (!out.ok())
+    {
+        cerr << "Unable to open: " << argv[1] << endl;
+        return 1;
+    }
+
+    std::mt19937_64 rng(seed);
+    auto uniform = [&rng](uint64_t low, uint64_t high)
+    {
+        return std::uniform_int_distribution<uint64_t>(low, high)(rng);
+    };
+    // Activity is skewed towards a few names, as on a real day.
+    std::geometric_distribution<uint32_t> stock_rank(8.0 / STOCKS);
+
+    uint64_t timestamp = MARKET_OPEN_NS - 3600ull * 1000000000ull;
+    uint64_t step = (MARKET_CLOSE_NS - timestamp) / (messages + 1);
+    auto tick = [&]()
+    {
+        timestamp += uniform(1, 2 * step);
+        return timestamp;
+    };
+
+    auto system_event = [&](char code)
+    {
+        out.begin('S', 0, tick());
+        out.put_char(code);
+        out.end();
+    };
+
+    vector<string> symbols(STOCKS + 1);
+    auto trading_action = [&](uint16_t stock_locate, char trading_state)
+    {
+        out.begin('H', stock_locate, tick());
+        out.put_text(symbols[stock_locate], 8);
+        out.put_char(trading_state);
+        out.put_char(' ');
+        out.put_text((trading_state == 'T') ? "" : "LUDP", 4);
+        out.end();
+    };
+
+    vector<uint32_t> reference_prices(STOCKS + 1);
+    system_event('O');
+    system_event('S');
+    for (uint16_t stock_locate = 1; stock_locate <= STOCKS; stock_locate++)
+    {
+        symbols[stock_locate] = symbol_name(stock_locate - 1);
+        reference_prices[stock_locate] = (uint32_t)uniform(5, 500) * 10000;
+
+        out.begin('R', stock_locate, tick());
+        out.put_text(symbols[stock_locate], 8);
+        out.put_char('Q');
+        out.put_char('N');
+        out.put_u32(100);
+        out.put_char('N');
+        out.put_char('C');
+        out.put_text("Z", 2);
+        out.put_char('P');
+        out.put_char('N');
+        out.put_char('N');
+        out.put_char('2');
+        out.put_char('N');
+        out.put_u32(0);
+        out.put_char('N');
+        out.end();
+
+        trading_action(stock_locate, 'T');
+    }
+    system_event('Q');
+
+    unordered_map<uint64_t, LiveOrder> live;
+    vector<uint64_t> live_refs;
+    unordered_map<uint64_t, size_t> live_positions;
+    uint64_t next_ref = 1;
+    uint64_t next_match = 1;
+    // Only an unbroken off-book trade is broken, so every 'B' finds its trade.
+    uint64_t breakable_match = 0;
+    uint16_t breakable_locate = 0;
+
+    auto insert_live = [&](uint64_t ref, const LiveOrder &order)
+    {
+        live[ref] = order;
+        live_positions[ref] = live_refs.size();
+        live_refs.push_back(ref);
+    };
+    auto erase_live = [&](uint64_t ref)
+    {
+        size_t position = live_positions[ref];
+        live_refs[position] = live_refs.back();
+        live_positions[live_refs[position]] = position;
+        live_refs.pop_back();
+        live_positions.erase(ref);
+        live.erase(ref);
+    };
+    auto reduce = [&](uint64_t ref, uint32_t shares)
+    {
+        LiveOrder &order = live[ref];
+        order.shares -= shares;
+        if (order.shares == 0)
+        {
+            erase_live(ref);
+        }
+    };
+    // Orders rest within 50 ticks of the reference price on their own side.
+    auto order_price = [&](uint16_t stock_locate, char side)
+    {
+        uint32_t offset = (uint32_t)uniform(0, 50) * 100;
+        uint32_t reference = reference_prices[stock_locate];
+        return (side == 'B') ? reference - 100 - offset : reference + offset;
+    };
+
+    uint16_t halted_locate = 0;
+    for (uint64_t n = 0; n < messages; n++)
+    {
+        if (n % HALT_INTERVAL == HALT_INTERVAL / 2)
+        {
+            halted_locate = (uint16_t)(1 + std::min<uint32_t>(stock_rank(rng), STOCKS - 1));
+            trading_action(halted_locate, 'H');
+            continue;
+        }
+        if (halted_locate != 0 && n % HALT_INTERVAL == HALT_INTERVAL / 2 + HALT_LENGTH)
+        {
+            trading_action(halted_locate, 'Q');
+            trading_action(halted_locate, 'T');
+            out.begin('Q', halted_locate, tick());
+            out.put_u64(uniform(1, 100) * 100);
+            out.put_text(symbols[halted_locate], 8);
+            out.put_u32(reference_prices[halted_locate]);
+            out.put_u64(next_match++);
+            out.put_char('H');
+            out.end();
+            halted_locate = 0;
+            continue;
+        }
+
+        uint32_t r = (uint32_t)uniform(0, 999);
+        uint16_t stock_locate = (uint16_t)(1 + std::min<uint32_t>(stock_rank(rng), STOCKS - 1));
+
+        if (r < 400 || live_refs.size() < 1000)
+        {
+            char side = uniform(0, 1) ? 'B' : 'S';
+            LiveOrder order = {stock_locate, side, order_price(stock_locate, side), (uint32_t)uniform(1, 10) * 100};
+            bool attributed = r % 10 == 0;
+            out.begin(attributed ? 'F' : 'A', stock_locate, tick());
+            out.put_u64(next_ref);
+            out.put_char(side);
+            out.put_u32(order.shares);
+            out.put_text(symbols[stock_locate], 8);
+            out.put_u32(order.price);
+            if (attributed)
+            {
+                out.put_text("MPID", 4);
+            }
+            out.end();
+            insert_live(next_ref++, order);
+            continue;
+        }
+
+        uint64_t ref = live_refs[uniform(0, live_refs.size() - 1)];
+        LiveOrder order = live[ref];
+        if (r < 700)
+        {
+            out.begin('D', order.stock_locate, tick());
+            out.put_u64(ref);
+            out.end();
+            erase_live(ref);
+        }
+        else if (r < 760)
+        {
+            uint32_t shares = (uint32_t)uniform(1, order.shares);
+            out.begin('X', order.stock_locate, tick());
+            out.put_u64(ref);
+            out.put_u32(shares);
+            out.end();
+            reduce(ref, shares);
+        }
+        else if (r < 830)
+        {
+            uint32_t shares = (uint32_t)uniform(1, order.shares);
+            out.begin('E', order.stock_locate, tick());
+            out.put_u64(ref);
+            out.put_u32(shares);
+            out.put_u64(next_match++);
+            out.end();
+            reduce(ref, shares);
+        }
+        else if (r < 840)
+        {
+            uint32_t shares = (uint32_t)uniform(1, order.shares);
+            out.begin('C', order.stock_locate, tick());
+            out.put_u64(ref);
+            out.put_u32(shares);
+            out.put_u64(next_match++);
+            out.put_char('Y');
+            out.put_u32(order.price);
+            out.end();
+            reduce(ref, shares);
+        }
+        else if (r < 950)
+        {
+            LiveOrder replacement = order;
+            replacement.shares = (uint32_t)uniform(1, 10) * 100;
+            replacement.price = order_price(order.stock_locate, order.side);
+            out.begin('U', order.stock_locate, tick());
+            out.put_u64(ref);
+            out.put_u64(next_ref);
+            out.put_u32(replacement.shares);
+            out.put_u32(replacement.price);
+            out.end();
+            erase_live(ref);
+            insert_live(next_ref++, replacement);
+        }
+        else if (r < 985)
+        {
+            out.begin('P', stock_locate, tick());
+            out.put_u64(0);
+            out.put_char('B');
+            out.put_u32((uint32_t)uniform(1, 10) * 100);
+            out.put_text(symbols[stock_locate], 8);
+            out.put_u32(reference_prices[stock_locate]);
+            breakable_match = next_match++;
+            breakable_locate = stock_locate;
+            out.put_u64(breakable_match);
+            out.end();
+        }
+        else if (r < 995)
+        {
+            out.begin('I', stock_locate, tick());
+            out.put_u64(uniform(0, 10000));
+            out.put_u64(uniform(0, 5000));
+            out.put_char('B');
+            out.put_text(symbols[stock_locate], 8);
+            out.put_u32(reference_prices[stock_locate]);
+            out.put_u32(reference_prices[stock_locate]);
+            out.put_u32(reference_prices[stock_locate]);
+            out.put_char('C');
+            out.put_char('L');
+            out.end();
+        }
+        else if (breakable_match != 0)
+        {
+            out.begin('B', breakable_locate, tick());
+            out.put_u64(breakable_match);
+            out.end();
+            breakable_match = 0;
+        }
+    }
+
+    system_event('M');
+    system_event('E');
+    system_event('C');
+    return out.ok() ? 0 : 1;
+}
@@ -0,0 +1,656 @@
+// Python extension over the C++ decoder and OrderBook.
+//
+//     import itch, numpy as np
+//     replay = itch.Replay("12302019.NASDAQ_ITCH50", symbols=["AAPL"])
+//     for batch in replay.batches(1 << 16):
+//         events = np.asarray(batch)          # zero-copy structured array
+//     depth = np.asarray(replay.snapshot(replay.stock_locate("AAPL")))
+//
+// Batches and snapshots export __array_interface__, so numpy wraps the C++
+// storage without copying and keeps the owning object alive; numpy is not needed
+// to build the module. Decoding and book updates run with the GIL released.
+// The itch_python CMake target builds it whenever the Python headers are found.
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <memory>
+#include <new>
+#include <vector>
+#include "feed_reader.h"
+#include "replay.h"
+
+// One decoded message. Fields a message type does not carry are zero.
+struct EventRecord
+{
+    uint64_t timestamp;
+    uint64_t order_reference_number;
+    uint64_t new_order_reference_number;
+    uint64_t match_number;
+    uint32_t shares;
+    uint32_t price;
+    uint16_t stock_locate;
+    char type;
+    char side;
+    char cross_type;
+    char printable;
+    uint16_t reserved;
+};
+
+static_assert(sizeof(EventRecord) == 48, "EventRecord must match EVENT_DESCR");
+
+// One book level of a snapshot, bids best first then asks best first.
+struct SnapshotLevel
+{
+    char side;
+    char reserved[3];
+    uint32_t price;
+    uint32_t order_count;
+    uint32_t reserved_2;
+    uint64_t volume;
+};
+
+static_assert(sizeof(SnapshotLevel) == 24, "SnapshotLevel must match SNAPSHOT_DESCR");
+
+struct RecordField
+{
+    const char *name;
+    const char *typestr;
+};
+
+// Prices are the raw ITCH integers (1/10000 dollar), as in Price::raw.
+static const RecordField EVENT_DESCR[] = {
+    {"timestamp", "<u8"},
+    {"order_reference_number", "<u8"},
+    {"new_order_reference_number", "<u8"},
+    {"match_number", "<u8"},
+    {"shares", "<u4"},
+    {"price", "<u4"},
+    {"stock_locate", "<u2"},
+    {"type", "|S1"},
+    {"side", "|S1"},
+    {"cross_type", "|S1"},
+    {"printable", "|b1"},
+    {"", "|V2"},
+};
+
+static const RecordField SNAPSHOT_DESCR[] = {
+    {"side", "|S1"},
+    {"", "|V3"},
+    {"price", "<u4"},
+    {"order_count", "<u4"},
+    {"", "|V4"},
+    {"volume", "<u8"},
+};
+
+struct RecordLayout
+{
+    const RecordField *fields;
+    size_t field_count;
+    size_t record_size;
+};
+
+static const RecordLayout EVENT_LAYOUT = {EVENT_DESCR, sizeof(EVENT_DESCR) / sizeof(RecordField), sizeof(EventRecord)};
+static const RecordLayout SNAPSHOT_LAYOUT = {SNAPSHOT_DESCR, sizeof(SNAPSHOT_DESCR) / sizeof(RecordField), sizeof(SnapshotLevel)};
+
+static EventRecord decode_event(const char *frame, uint16_t frame_length)
+{
+    EventRecord event = {};
+    const char *body = &frame[1];
+    uint16_t length = frame_length - 1;
+    Header header = parse_header(body);
+    event.timestamp = header.timestamp;
+    event.stock_locate = header.stock_locate;
+    event.type = frame[0];
+
+    switch (get_message_type(frame[0]))
+    {
+    case MessageType::ADD_ORDER_MESSAGE:
+    {
+        AddOrderMessage message = parse_add_order_message(body, length);
+        event.order_reference_number = message.order_reference_number;
+        event.side = message.buy_sell_indicator;
+        event.shares = message.shares;
+        event.price = message.price.raw;
+        break;
+    }
+    case MessageType::DELETE_CANCEL_MESSAGE:
+    {
+        DeleteCancelMessage message = parse_delete_cancel_message(body, length);
+        event.order_reference_number = message.order_reference_number;
+        event.shares = message.cancelled_shares;
+        break;
+    }
+    case MessageType::REPLACE_MESSAGE:
+    {
+        ReplaceOrderMessage message = parse_replace_order_message(body);
+        event.order_reference_number = message.original_order_reference_number;
+        event.new_order_reference_number = message.new_order_reference_number;
+        event.shares = message.shares;
+        event.price = message.price.raw;
+        break;
+    }
+    case MessageType::ORDER_EXECUTED_MESSAGE:
+    {
+        OrderExecutedMessage message = parse_order_executed_message(body);
+        event.order_reference_number = message.order_reference_number;
+        event.shares = message.executed_shares;
+        event.match_number = message.match_number;
+        event.printable = 1;
+        break;
+    }
+    case MessageType::ORDER_EXECUTED_PRICE_MESSAGE:
+    {
+        OrderExecutedPriceMessage message = parse_order_executed_price_message(body);
+        event.order_reference_number = message.order_reference_number;
+        event.shares = message.executed_shares;
+        event.match_number = message.match_number;
+        event.price = message.execution_price.raw;
+        event.printable = message.printable;
+        break;
+    }
+    case MessageType::TRADE_NON_CROSS_MESSAGE:
+    {
+        TradeNonCrossMessage message = parse_trade_non_cross_message(body);
+        event.shares = message.shares;
+        event.price = message.price.raw;
+        event.match_number = message.match_number;
+        event.printable = 1;
+        break;
+    }
+    case MessageType::TRADE_CROSS_MESSAGE:
+    {
+        TradeCrossMessage message = parse_trade_cross_message(body);
+        event.shares = (uint32_t)message.shares;
+        event.price = message.cross_price.raw;
+        event.match_number = message.match_number;
+        event.cross_type = message.cross_type;
+        event.printable = 1;
+        break;
+    }
+    case MessageType::BROKEN_TRADE_MESSAGE:
+    {
+        BrokenTradeMessage message = parse_broken_trade_message(body);
+        event.match_number = message.match_number;
+        break;
+    }
+    default:
+        break;
+    }
+    return event;
+}
+
+// RecordArray: owns a block of fixed-size records and exposes it to numpy.
+
+struct RecordArrayObject
+{
+    PyObject_HEAD
+    std::vector<char> *storage;
+    size_t count;
+    const RecordLayout *layout;
+};
+
+static void record_array_dealloc(RecordArrayObject *self)
+{
+    delete self->storage;
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static Py_ssize_t record_array_length(RecordArrayObject *self)
+{
+    return (Py_ssize_t)self->count;
+}
+
+static PyObject *record_array_interface(RecordArrayObject *self, void *)
+{
+    PyObject *descr = PyList_New((Py_ssize_t)self->layout->field_count);
+    if (descr == nullptr)
+    {
+        return nullptr;
+    }
+    for (size_t i = 0; i < self->layout->field_count; i++)
+    {
+        PyList_SET_ITEM(descr, i, Py_BuildValue("(ss)", self->layout->fields[i].name, self->layout->fields[i].typestr));
+    }
+
+    char typestr[32];
+    snprintf(typestr, sizeof(typestr), "|V%zu", self->layout->record_size);
+    return Py_BuildValue("{s:(n),s:s,s:N,s:(KO),s:i}",
+                         "shape", (Py_ssize_t)self->count,
+                         "typestr", typestr,
+                         "descr", descr,
+                         "data", (unsigned long long)(uintptr_t)self->storage->data(), Py_False,
+                         "version", 3);
+}
+
+static PyGetSetDef record_array_getset[] = {
+    {"__array_interface__", (getter)record_array_interface, nullptr, "numpy array interface over the records", nullptr},
+    {nullptr, nullptr, nullptr, nullptr, nullptr},
+};
+
+static PySequenceMethods record_array_sequence;
+
+static PyTypeObject RecordArrayType;
+
+static PyObject *new_record_array(std::vector<char> *storage, size_t count, const RecordLayout *layout)
+{
+    RecordArrayObject *array = PyObject_New(RecordArrayObject, &RecordArrayType);
+    if (array == nullptr)
+    {
+        delete storage;
+        return nullptr;
+    }
+    array->storage = storage;
+    array->count = count;
+    array->layout = layout;
+    return (PyObject *)array;
+}
+
+// Replay: a capture being replayed into an OrderBook.
+
+struct ReplayObject
+{
+    PyObject_HEAD
+    Replay *replay;
+    FeedReader *reader;
+    bool finished;
+    // Set while the GIL is released, so another Python thread cannot step the same replay.
+    bool busy;
+};
+
+static void replay_dealloc(ReplayObject *self)
+{
+    delete self->reader;
+    delete self->replay;
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static int replay_init(ReplayObject *self, PyObject *args, PyObject *kwargs)
+{
+    static const char *keywords[] = {"path", "symbols", nullptr};
+    const char *path;
+    PyObject *symbols = nullptr;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s|O", (char **)keywords, &path, &symbols))
+    {
+        return -1;
+    }
+    // next_batch and run step the replay with the GIL released; it cannot be replaced under them.
+    if (self->busy)
+    {
+        PyErr_SetString(PyExc_RuntimeError, "Replay is in use by another thread");
+        return -1;
+    }
+
+    delete self->reader;
+    delete self->replay;
+    self->replay = new (std::nothrow) Replay();
+    self->reader = new (std::nothrow) FeedReader();
+    self->finished = false;
+    self->busy = false;
+    if (self->replay == nullptr || self->reader == nullptr)
+    {
+        PyErr_NoMemory();
+        return -1;
+    }
+
+    if (symbols != nullptr && symbols != Py_None)
+    {
+        PyObject *iterator = PyObject_GetIter(symbols);
+        if (iterator == nullptr)
+        {
+            return -1;
+        }
+        while (PyObject *symbol = PyIter_Next(iterator))
+        {
+            const char *text = PyUnicode_AsUTF8(symbol);
+            if (text != nullptr)
+            {
+                self->replay->symbol_filter.add_symbol(text);
+            }
+            Py_DECREF(symbol);
+            if (text == nullptr)
+            {
+                Py_DECREF(iterator);
+                return -1;
+            }
+        }
+        Py_DECREF(iterator);
+        if (PyErr_Occurred())
+        {
+            return -1;
+        }
+    }
+
+    bool opened;
+    Py_BEGIN_ALLOW_THREADS;
+    opened = self->reader->open(path);
+    Py_END_ALLOW_THREADS;
+    if (!opened)
+    {
+        PyErr_Format(PyExc_OSError, "unable to open %s", path);
+        return -1;
+    }
+    return 0;
+}
+
+static bool acquire_replay(ReplayObject *self)
+{
+    if (self->replay == nullptr)
+    {
+        PyErr_SetString(PyExc_RuntimeError, "Replay is not initialised");
+        return false;
+    }
+    if (self->busy)
+    {
+        PyErr_SetString(PyExc_RuntimeError, "Replay is in use by another thread");
+        return false;
+    }
+    self->busy = true;
+    return true;
+}
+
+// Applies frames until max_frames were read or the feed ends. When events is
+// set, every message that passed the filter and validation is decoded into it.
+// Runs without the GIL.
+static uint64_t advance(ReplayObject *self, uint64_t max_frames, std::vector<char> *events)
+{
+    Replay &replay = *self->replay;
+    const char *frame;
+    uint16_t frame_length;
+    uint64_t frames = 0;
+
+    while (frames < max_frames && !self->finished)
+    {
+        FrameStatus status = self->reader->next_frame(frame, frame_length);
+        if (status != FrameStatus::OK)
+        {
+            replay.counters.truncated_frames += (status == FrameStatus::TRUNCATED);
+            replay.counters.read_errors += (status == FrameStatus::READ_ERROR);
+            self->finished = true;
+            break;
+        }
+        frames++;
+
+        uint64_t skipped = replay.counters.filtered_frames + replay.counters.skipped_frames + replay.counters.malformed_frames;
+        replay.apply_frame(frame, frame_length);
+        if (events != nullptr && replay.counters.filtered_frames + replay.counters.skipped_frames + replay.counters.malformed_frames == skipped)
+        {
+            EventRecord event = decode_event(frame, frame_length);
+            events->insert(events->end(), (const char *)&event, (const char *)(&event + 1));
+        }
+    }
+    return frames;
+}
+
+static PyObject *replay_next_batch(ReplayObject *self, PyObject *args)
+{
+    Py_ssize_t max_frames = 1 << 16;
+    if (!PyArg_ParseTuple(args, "|n", &max_frames))
+    {
+        return nullptr;
+    }
+    if (max_frames <= 0)
+    {
+        PyErr_SetString(PyExc_ValueError, "max_frames must be positive");
+        return nullptr;
+    }
+    if (!acquire_replay(self))
+    {
+        return nullptr;
+    }
+
+    auto *events = new std::vector<char>();
+    Py_BEGIN_ALLOW_THREADS;
+    events->reserve(max_frames * sizeof(EventRecord));
+    advance(self, (uint64_t)max_frames, events);
+    Py_END_ALLOW_THREADS;
+    self->busy = false;
+
+    if (events->empty() && self->finished)
+    {
+        delete events;
+        Py_RETURN_NONE;
+    }
+    return new_record_array(events, events->size() / sizeof(EventRecord), &EVENT_LAYOUT);
+}
+
+static PyObject *replay_run(ReplayObject *self, PyObject *)
+{
+    if (!acquire_replay(self))
+    {
+        return nullptr;
+    }
+
+    uint64_t frames;
+    Py_BEGIN_ALLOW_THREADS;
+    frames = advance(self, UINT64_MAX, nullptr);
+    Py_END_ALLOW_THREADS;
+    self->busy = false;
+    return PyLong_FromUnsignedLongLong(frames);
+}
+
+static PyObject *replay_snapshot(ReplayObject *self, PyObject *args)
+{
+    unsigned int stock_locate;
+    unsigned int depth = SNAPSHOT_DEPTH;
+    if (!PyArg_ParseTuple(args, "I|I", &stock_locate, &depth) || !acquire_replay(self))
+    {
+        return nullptr;
+    }
+    self->busy = false;
+    if (depth == 0 || depth > 1024)
+    {
+        PyErr_SetString(PyExc_ValueError, "depth must be between 1 and 1024");
+        return nullptr;
+    }
+    if (stock_locate > UINT16_MAX)
+    {
+        PyErr_SetString(PyExc_ValueError, "stock_locate out of range");
+        return nullptr;
+    }
+
+    std::vector<DepthLevel> bids(depth), asks(depth);
+    uint32_t bid_count = self->replay->order_book.get_bid_depth((uint16_t)stock_locate, bids.data(), depth);
+    uint32_t ask_count = self->replay->order_book.get_ask_depth((uint16_t)stock_locate, asks.data(), depth);
+
+    auto *storage = new std::vector<char>((bid_count + ask_count) * sizeof(SnapshotLevel));
+    SnapshotLevel *levels = (SnapshotLevel *)storage->data();
+    for (uint32_t i = 0; i < bid_count + ask_count; i++)
+    {
+        const DepthLevel &level = (i < bid_count) ? bids[i] : asks[i - bid_count];
+        levels[i] = {};
+        levels[i].side = (i < bid_count) ? 'B' : 'S';
+        levels[i].price = level.price.raw;
+        levels[i].order_count = level.order_count;
+        levels[i].volume = level.volume;
+    }
+    return new_record_array(storage, bid_count + ask_count, &SNAPSHOT_LAYOUT);
+}
+
+static PyObject *replay_stock_locate(ReplayObject *self, PyObject *args)
+{
+    const char *symbol;
+    if (!PyArg_ParseTuple(args, "s", &symbol) || !acquire_replay(self))
+    {
+        return nullptr;
+    }
+    self->busy = false;
+
+    string padded = string(symbol).substr(0, 8);
+    padded.resize(8, ' ');
+    uint16_t stock_locate = self->replay->i_table.get_stock_locate_from_stock(padded);
+    if (stock_locate == 0)
+    {
+        Py_RETURN_NONE;
+    }
+    return PyLong_FromUnsignedLong(stock_locate);
+}
+
+static PyObject *replay_counters(ReplayObject *self, void *)
+{
+    if (self->replay == nullptr)
+    {
+        Py_RETURN_NONE;
+    }
+    const ReplayCounters &counters = self->replay->counters;
+    return Py_BuildValue("{s:K,s:K,s:K,s:K,s:K,s:K,s:K,s:K,s:K,s:n}",
+                         "frames", counters.frames,
+                         "bytes", counters.bytes,
+                         "filtered_frames", counters.filtered_frames,
+                         "skipped_frames", counters.skipped_frames,
+                         "malformed_frames", counters.malformed_frames,
+                         "truncated_frames", counters.truncated_frames,
+                         "read_errors", counters.read_errors,
+                         "book_errors", counters.book_errors,
+                         "reference_errors", counters.reference_errors,
+                         "live_orders", (Py_ssize_t)self->replay->order_book.live_orders());
+}
+
+static PyObject *replay_finished(ReplayObject *self, void *)
+{
+    return PyBool_FromLong(self->finished);
+}
+
+// batches(): iterator over next_batch until the feed ends.
+
+struct BatchIteratorObject
+{
+    PyObject_HEAD
+    PyObject *replay;
+    Py_ssize_t max_frames;
+};
+
+static void batch_iterator_dealloc(BatchIteratorObject *self)
+{
+    Py_XDECREF(self->replay);
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static PyTypeObject BatchIteratorType;
+
+static PyObject *batch_iterator_next(PyObject *self)
+{
+    BatchIteratorObject *iterator = (BatchIteratorObject *)self;
+    PyObject *args = Py_BuildValue("(n)", iterator->max_frames);
+    if (args == nullptr)
+    {
+        return nullptr;
+    }
+    PyObject *batch = replay_next_batch((ReplayObject *)iterator->replay, args);
+    Py_DECREF(args);
+    if (batch == Py_None)
+    {
+        // Returning nullptr without an exception ends the iteration.
+        Py_DECREF(batch);
+        return nullptr;
+    }
+    return batch;
+}
+
+static PyObject *replay_batches(ReplayObject *self, PyObject *args)
+{
+    Py_ssize_t max_frames = 1 << 16;
+    if (!PyArg_ParseTuple(args, "|n", &max_frames))
+    {
+        return nullptr;
+    }
+    BatchIteratorObject *iterator = PyObject_New(BatchIteratorObject, &BatchIteratorType);
+    if (iterator == nullptr)
+    {
+        return nullptr;
+    }
+    Py_INCREF(self);
+    iterator->replay = (PyObject *)self;
+    iterator->max_frames = max_frames;
+    return (PyObject *)iterator;
+}
+
+static PyMethodDef replay_methods[] = {
+    {"batches", (PyCFunction)replay_batches, METH_VARARGS,
+     "batches(max_frames=65536) -> iterator of RecordArray batches until the end of the feed."},
+    {"next_batch", (PyCFunction)replay_next_batch, METH_VARARGS,
+     "next_batch(max_frames=65536) -> RecordArray of decoded messages, or None at the end of the feed."},
+    {"run", (PyCFunction)replay_run, METH_NOARGS,
+     "run() -> number of frames applied; replays the rest of the feed."},
+    {"snapshot", (PyCFunction)replay_snapshot, METH_VARARGS,
+     "snapshot(stock_locate, depth=5) -> RecordArray of levels, bids then asks, best first."},
+    {"stock_locate", (PyCFunction)replay_stock_locate, METH_VARARGS,
+     "stock_locate(symbol) -> int, or None if the symbol has not been seen yet."},
+    {nullptr, nullptr, 0, nullptr},
+};
+
+static PyGetSetDef replay_getset[] = {
+    {"counters", (getter)replay_counters, nullptr, "Replay counters as a dict.", nullptr},
+    {"finished", (getter)replay_finished, nullptr, "True once the end of the feed was reached.", nullptr},
+    {nullptr, nullptr, nullptr, nullptr, nullptr},
+};
+
+static PyTypeObject ReplayType;
+
+static struct PyModuleDef itch_module;
+
+// The type and module objects start zeroed and are filled in here: C++ cannot
+// designate the initializers of PyTypeObject after the head macro, and a partial
+// positional initializer leaves every other slot to -Wmissing-field-initializers.
+static void setup_types()
+{
+    const PyVarObject type_head = {PyObject_HEAD_INIT(nullptr) 0};
+    RecordArrayType.ob_base = type_head;
+    BatchIteratorType.ob_base = type_head;
+    ReplayType.ob_base = type_head;
+
+    RecordArrayType.tp_name = "itch.RecordArray";
+    RecordArrayType.tp_basicsize = sizeof(RecordArrayObject);
+    RecordArrayType.tp_dealloc = (destructor)record_array_dealloc;
+    record_array_sequence.sq_length = (lenfunc)record_array_length;
+    RecordArrayType.tp_as_sequence = &record_array_sequence;
+    RecordArrayType.tp_flags = Py_TPFLAGS_DEFAULT;
+    RecordArrayType.tp_doc = "Fixed-size records owned by C++; wrap with numpy.asarray().";
+    RecordArrayType.tp_getset = record_array_getset;
+
+    BatchIteratorType.tp_name = "itch.BatchIterator";
+    BatchIteratorType.tp_basicsize = sizeof(BatchIteratorObject);
+    BatchIteratorType.tp_dealloc = (destructor)batch_iterator_dealloc;
+    BatchIteratorType.tp_flags = Py_TPFLAGS_DEFAULT;
+    BatchIteratorType.tp_iter = PyObject_SelfIter;
+    BatchIteratorType.tp_iternext = batch_iterator_next;
+
+    ReplayType.tp_name = "itch.Replay";
+    ReplayType.tp_basicsize = sizeof(ReplayObject);
+    ReplayType.tp_dealloc = (destructor)replay_dealloc;
+    ReplayType.tp_flags = Py_TPFLAGS_DEFAULT;
+    ReplayType.tp_doc = "Replay(path, symbols=None): replays an ITCH 5.0 capture into an order book.";
+    ReplayType.tp_methods = replay_methods;
+    ReplayType.tp_getset = replay_getset;
+    ReplayType.tp_init = (initproc)replay_init;
+    ReplayType.tp_new = PyType_GenericNew;
+
+    const PyModuleDef_Base module_head = PyModuleDef_HEAD_INIT;
+    itch_module.m_base = module_head;
+    itch_module.m_name = "itch";
+    itch_module.m_doc = "ITCH 5.0 replay and order book, with numpy-compatible record batches.";
+    itch_module.m_size = -1;
+}
+
+PyMODINIT_FUNC PyInit_itch(void)
+{
+    setup_types();
+    if (PyType_Ready(&RecordArrayType) < 0 || PyType_Ready(&BatchIteratorType) < 0 || PyType_Ready(&ReplayType) < 0)
+    {
+        return nullptr;
+    }
+
+    PyObject *module = PyModule_Create(&itch_module);
+    if (module == nullptr)
+    {
+        return nullptr;
+    }
+    Py_INCREF(&ReplayType);
+    Py_INCREF(&RecordArrayType);
+    if (PyModule_AddObject(module, "Replay", (PyObject *)&ReplayType) < 0 ||
+        PyModule_AddObject(module, "RecordArray", (PyObject *)&RecordArrayType) < 0)
+    {
+        Py_DECREF(module);
+        return nullptr;
+    }
+    return module;
+}
@@ -0,0 +1,97 @@
+#include <cstring>
+#include <iomanip>
+#include "helper.h"
+#include "lifecycle_tracker.h"
+
+bool LifecycleTracker::open(const string &path)
+{
+    file.open(path, std::ios::binary);
+    if (!file)
+    {
+        return false;
+    }
+
+    LifecycleFileHeader header = {};
+    memcpy(header.magic, LIFECYCLE_MAGIC, sizeof(header.magic));
+    header.version = LIFECYCLE_VERSION;
+    header.record_size = sizeof(LifecycleRecord);
+    file.write((const char *)&header, sizeof(header));
+    pending.reserve(WRITE_BATCH);
+    return (bool)file;
+}
+
+void LifecycleTracker::flush()
+{
+    if (file.is_open() && !pending.empty())
+    {
+        file.write((const char *)pending.data(), pending.size() * sizeof(LifecycleRecord));
+        file.flush();
+    }
+    pending.clear();
+}
+
+void LifecycleTracker::finish(uint64_t timestamp)
+{
+    vector<uint64_t> open_orders;
+    open_orders.reserve(index.size());
+    index.for_each([&](uint64_t order_reference_number, uint32_t)
+                   { open_orders.push_back(order_reference_number); });
+    for (uint64_t order_reference_number : open_orders)
+    {
+        end(index.find(order_reference_number), LifecycleEnd::OPEN, timestamp);
+    }
+    flush();
+}
+
+// Upper bound of the histogram bucket holding the given quantile, or 0 if the histogram is empty.
+static uint64_t duration_quantile(const uint64_t *histogram, double quantile)
+{
+    uint64_t total = 0;
+    for (uint32_t bucket = 0; bucket < LIFECYCLE_DURATION_BUCKETS; bucket++)
+    {
+        total += histogram[bucket];
+    }
+
+    uint64_t seen = 0;
+    for (uint32_t bucket = 0; bucket < LIFECYCLE_DURATION_BUCKETS && total > 0; bucket++)
+    {
+        seen += histogram[bucket];
+        if (seen >= quantile * total)
+        {
+            return 1ull << bucket;
+        }
+    }
+    return 0;
+}
+
+static void print_durations(std::ostream &os, const char *name, const uint64_t *histogram)
+{
+    os << name << " (ns, power-of-two upper bounds): p50 <= " << duration_quantile(histogram, 0.5)
+       << " | p90 <= " << duration_quantile(histogram, 0.9)
+       << " | p99 <= " << duration_quantile(histogram, 0.99) << std::endl;
+}
+
+void LifecycleTracker::print_summary(std::ostream &os) const
+{
+    os << "Order chains: " << std::dec << ended[(uint8_t)LifecycleEnd::FILLED] << " filled | "
+       << ended[(uint8_t)LifecycleEnd::CANCELLED] << " cancelled | "
+       << ended[(uint8_t)LifecycleEnd::DELETED] << " deleted | "
+       << ended[(uint8_t)LifecycleEnd::OPEN] << " open" << std::endl;
+    print_durations(os, "Time to first fill", first_fill_histogram);
+    print_durations(os, "Time to cancel", cancel_histogram);
+    print_durations(os, "Lifetime", lifetime_histogram);
+
+    os << "Fill ratio,Chains" << std::endl;
+    for (uint32_t bucket = 0; bucket < LIFECYCLE_FILL_BUCKETS; bucket++)
+    {
+        os << bucket * 10 << "%," << fill_histogram[bucket] << std::endl;
+    }
+    os << "Replaces,Chains" << std::endl;
+    for (uint32_t bucket = 0; bucket < LIFECYCLE_REPLACE_BUCKETS; bucket++)
+    {
+        if (replace_histogram[bucket] > 0)
+        {
+            os << bucket << (bucket == LIFECYCLE_REPLACE_BUCKETS - 1 ? "+" : "") << "," << replace_histogram[bucket] << std::endl;
+        }
+    }
+}
@@ -0,0 +1,292 @@
+#ifndef LIFECYCLE_TRACKER_H
+#define LIFECYCLE_TRACKER_H
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "order_index.h"
+using namespace std;
+
+constexpr char LIFECYCLE_MAGIC[8] = {'I', 'T', 'C', 'H', 'L', 'I', 'F', 'E'};
+constexpr uint32_t LIFECYCLE_VERSION = 2;
+// LifecycleRecord flags, from the stock's state when the chain was added.
+constexpr uint16_t LIFECYCLE_FLAG_SHORT_SALE_RESTRICTED = 1 << 0;
+constexpr uint16_t LIFECYCLE_FLAG_REOPENING = 1 << 1;
+// Durations are histogrammed in powers of two of nanoseconds: bucket i counts
+// [2^(i-1), 2^i) ns, so 48 buckets reach past a whole day.
+constexpr uint32_t LIFECYCLE_DURATION_BUCKETS = 48;
+// Fill ratio in tenths; the last bucket is fully filled.
+constexpr uint32_t LIFECYCLE_FILL_BUCKETS = 11;
+constexpr uint32_t LIFECYCLE_REPLACE_BUCKETS = 16;
+
+// How an order chain ended.
+enum class LifecycleEnd : char
+{
+    FILLED = 'F',
+    CANCELLED = 'C',
+    DELETED = 'D',
+    // Still resting when the replay stopped.
+    OPEN = 'O'
+};
+
+// One finished order chain: the original add and every replace that followed
+// it. Every share posted by the chain is either executed or cancelled, where the
+// shares left on an order when it is replaced count as cancelled.
+struct LifecycleRecord
+{
+    uint64_t original_order_reference_number;
+    uint64_t final_order_reference_number;
+    uint64_t add_timestamp;
+    // 0 if the chain never traded.
+    uint64_t first_fill_timestamp;
+    uint64_t end_timestamp;
+    uint32_t executed_shares;
+    uint32_t cancelled_shares;
+    uint16_t stock_locate;
+    uint16_t replaces;
+    char side;
+    LifecycleEnd end;
+    uint16_t flags;
+};
+
+static_assert(sizeof(LifecycleRecord) == 56, "LifecycleRecord is written to disk as is");
+
+// Layout of the record file: this header followed by LifecycleRecords in the
+// order the chains ended.
+struct LifecycleFileHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+};
+
+// Follows every order from its add through replaces to its last execution,
+// cancel or delete, and keeps per-order latency and fill statistics. Chains are
+// held in pooled slots indexed by the current reference number; a slot goes
+// back to the free list as soon as its chain ends, so memory tracks the number
+// of resting orders rather than the day's total.
+class LifecycleTracker
+{
+public:
+    ~LifecycleTracker()
+    {
+        flush();
+    }
+
+    // Streams a record for every finished chain to path. Returns false if it cannot be created.
+    bool open(const string &path);
+
+    void on_add(uint64_t order_reference_number, uint16_t stock_locate, char side, uint32_t shares, uint64_t timestamp, uint16_t flags)
+    {
+        uint32_t handle = allocate();
+        if (!index.insert(order_reference_number, handle))
+        {
+            release(handle);
+            return;
+        }
+
+        Chain &chain = chains[handle];
+        chain = {};
+        chain.record.original_order_reference_number = order_reference_number;
+        chain.record.final_order_reference_number = order_reference_number;
+        chain.record.add_timestamp = timestamp;
+        chain.record.stock_locate = stock_locate;
+        chain.record.side = side;
+        chain.record.flags = flags;
+        chain.remaining_shares = shares;
+    }
+
+    void on_execute(uint64_t order_reference_number, uint32_t shares, uint64_t timestamp)
+    {
+        size_t slot = index.find(order_reference_number);
+        if (slot == OrderIndex::NOT_FOUND)
+        {
+            return;
+        }
+
+        Chain &chain = chains[index.handle_at(slot)];
+        shares = std::min(shares, chain.remaining_shares);
+        if (chain.record.first_fill_timestamp == 0)
+        {
+            chain.record.first_fill_timestamp = timestamp;
+        }
+        chain.record.executed_shares += shares;
+        chain.remaining_shares -= shares;
+        if (chain.remaining_shares == 0)
+        {
+            end(slot, LifecycleEnd::FILLED, timestamp);
+        }
+    }
+
+    void on_cancel(uint64_t order_reference_number, uint32_t shares, uint64_t timestamp)
+    {
+        size_t slot = index.find(order_reference_number);
+        if (slot == OrderIndex::NOT_FOUND)
+        {
+            return;
+        }
+
+        Chain &chain = chains[index.handle_at(slot)];
+        shares = std::min(shares, chain.remaining_shares);
+        chain.record.cancelled_shares += shares;
+        chain.remaining_shares -= shares;
+        if (chain.remaining_shares == 0)
+        {
+            end(slot, LifecycleEnd::CANCELLED, timestamp);
+        }
+    }
+
+    void on_delete(uint64_t order_reference_number, uint64_t timestamp)
+    {
+        size_t slot = index.find(order_reference_number);
+        if (slot == OrderIndex::NOT_FOUND)
+        {
+            return;
+        }
+
+        Chain &chain = chains[index.handle_at(slot)];
+        chain.record.cancelled_shares += chain.remaining_shares;
+        chain.remaining_shares = 0;
+        end(slot, LifecycleEnd::DELETED, timestamp);
+    }
+
+    // The chain moves to the new reference number and keeps its history.
+    void on_replace(uint64_t original_order_reference_number, uint64_t new_order_reference_number, uint32_t shares)
+    {
+        size_t slot = index.find(original_order_reference_number);
+        if (slot == OrderIndex::NOT_FOUND)
+        {
+            return;
+        }
+
+        uint32_t handle = index.handle_at(slot);
+        index.erase_at(slot);
+        if (!index.insert(new_order_reference_number, handle))
+        {
+            release(handle);
+            return;
+        }
+
+        Chain &chain = chains[handle];
+        chain.record.final_order_reference_number = new_order_reference_number;
+        chain.record.cancelled_shares += chain.remaining_shares;
+        if (chain.record.replaces < UINT16_MAX)
+        {
+            chain.record.replaces++;
+        }
+        chain.remaining_shares = shares;
+    }
+
+    // Ends every chain still resting as OPEN; call once the replay is done.
+    void finish(uint64_t timestamp);
+
+    // Chains currently being followed.
+    size_t live_chains() const
+    {
+        return index.size();
+    }
+
+    void print_summary(std::ostream &os = std::cout) const;
+
+private:
+    struct Chain
+    {
+        LifecycleRecord record;
+        uint32_t remaining_shares;
+        // Next free slot while the chain is on the free list.
+        uint32_t next_free;
+    };
+
+    static constexpr size_t WRITE_BATCH = 4096;
+
+    OrderIndex index;
+    vector<Chain> chains;
+    uint32_t free_list = NO_ORDER;
+
+    std::ofstream file;
+    vector<LifecycleRecord> pending;
+
+    uint64_t ended[256] = {};
+    uint64_t first_fill_histogram[LIFECYCLE_DURATION_BUCKETS] = {};
+    uint64_t cancel_histogram[LIFECYCLE_DURATION_BUCKETS] = {};
+    uint64_t lifetime_histogram[LIFECYCLE_DURATION_BUCKETS] = {};
+    uint64_t fill_histogram[LIFECYCLE_FILL_BUCKETS] = {};
+    uint64_t replace_histogram[LIFECYCLE_REPLACE_BUCKETS] = {};
+
+    uint32_t allocate()
+    {
+        if (free_list != NO_ORDER)
+        {
+            uint32_t handle = free_list;
+            free_list = chains[handle].next_free;
+            return handle;
+        }
+        chains.emplace_back();
+        return (uint32_t)(chains.size() - 1);
+    }
+
+    void release(uint32_t handle)
+    {
+        chains[handle].next_free = free_list;
+        free_list = handle;
+    }
+
+    static uint32_t duration_bucket(uint64_t nanoseconds)
+    {
+        uint32_t bucket = (nanoseconds == 0) ? 0 : 64 - __builtin_clzll(nanoseconds);
+        return (bucket < LIFECYCLE_DURATION_BUCKETS) ? bucket : LIFECYCLE_DURATION_BUCKETS - 1;
+    }
+
+    void end(size_t slot, LifecycleEnd how, uint64_t timestamp)
+    {
+        uint32_t handle = index.handle_at(slot);
+        index.erase_at(slot);
+        LifecycleRecord &record = chains[handle].record;
+        record.end = how;
+        record.end_timestamp = timestamp;
+        record_statistics(record);
+        if (file.is_open())
+        {
+            pending.push_back(record);
+            if (pending.size() == WRITE_BATCH)
+            {
+                flush();
+            }
+        }
+        release(handle);
+    }
+
+    // Timestamps can step back slightly in a capture, so durations are clamped at 0.
+    static uint64_t elapsed(uint64_t from, uint64_t to)
+    {
+        return (to > from) ? to - from : 0;
+    }
+
+    void record_statistics(const LifecycleRecord &record)
+    {
+        ended[(uint8_t)record.end]++;
+        lifetime_histogram[duration_bucket(elapsed(record.add_timestamp, record.end_timestamp))]++;
+        if (record.first_fill_timestamp != 0)
+        {
+            first_fill_histogram[duration_bucket(elapsed(record.add_timestamp, record.first_fill_timestamp))]++;
+        }
+        if (record.end == LifecycleEnd::CANCELLED || record.end == LifecycleEnd::DELETED)
+        {
+            cancel_histogram[duration_bucket(elapsed(record.add_timestamp, record.end_timestamp))]++;
+        }
+
+        uint64_t posted = (uint64_t)record.executed_shares + record.cancelled_shares;
+        if (record.end != LifecycleEnd::OPEN && posted > 0)
+        {
+            fill_histogram[(uint64_t)record.executed_shares * (LIFECYCLE_FILL_BUCKETS - 1) / posted]++;
+        }
+        replace_histogram[std::min<uint32_t>(record.replaces, LIFECYCLE_REPLACE_BUCKETS - 1)]++;
+    }
+
+    void flush();
+};
+
+#endif // LIFECYCLE_TRACKER_H
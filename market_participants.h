@@ -48,7 +48,25 @@ public:
             .market_maker_mode = message.market_maker_mode,
             .market_participant_state = message.market_participant_state};
 
-        market_participants[string(message.mpid, 4)][string(message.stock, 8)] = flags;
+        set_position(string(message.mpid, 4), string(message.stock, 8), flags);
+    }
+
+    void set_position(const string &mpid, const string &stock, const MarketParticipantFlags &flags)
+    {
+        market_participants[mpid][stock] = flags;
+    }
+
+    // Calls function(mpid, stock, flags) for every registration, in no particular order.
+    template <typename Function>
+    void for_each_position(Function function) const
+    {
+        for (const auto &[mpid, stocks] : market_participants)
+        {
+            for (const auto &[stock, flags] : stocks)
+            {
+                function(mpid, stock, flags);
+            }
+        }
     }
 };
 
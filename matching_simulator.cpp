@@ -0,0 +1,276 @@
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include "helper.h"
+#include "matching_simulator.h"
+
+// Parses a dollar price with up to four decimals, e.g. 12.5 or 12.3450.
+static bool parse_price(const string &text, Price &price)
+{
+    uint64_t raw = 0;
+    int decimals = -1;
+    for (char c : text)
+    {
+        if (c == '.' && decimals < 0)
+        {
+            decimals = 0;
+            continue;
+        }
+        if (c < '0' || c > '9' || decimals == 4)
+        {
+            return false;
+        }
+        raw = raw * 10 + (uint64_t)(c - '0');
+        if (decimals >= 0)
+        {
+            decimals++;
+        }
+    }
+    for (int i = std::max(decimals, 0); i < 4; i++)
+    {
+        raw *= 10;
+    }
+    if (text.empty() || raw == 0 || raw > UINT32_MAX)
+    {
+        return false;
+    }
+    price = Price((uint32_t)raw);
+    return true;
+}
+
+uint32_t MatchingSimulator::submit(const string &symbol, char side, Price price, uint32_t shares, uint64_t timestamp, uint64_t cancel_timestamp)
+{
+    uint32_t order = (uint32_t)simulated_orders.size();
+    string stock = symbol;
+    stock.resize(8, ' ');
+    simulated_orders.push_back({.stock = stock,
+                                .side = side,
+                                .price = price,
+                                .shares = shares,
+                                .submit_timestamp = timestamp,
+                                .cancel_timestamp = cancel_timestamp,
+                                .entry_timestamp = 0,
+                                .first_fill_timestamp = 0,
+                                .filled_shares = 0,
+                                .handle = NO_ORDER,
+                                .state = SimulatedOrderState::PENDING});
+    events.push({.timestamp = timestamp + delay(latency.order_entry), .order = order, .cancel = false});
+    if (cancel_timestamp != 0)
+    {
+        events.push({.timestamp = cancel_timestamp + delay(latency.cancel), .order = order, .cancel = true});
+    }
+    return order;
+}
+
+bool MatchingSimulator::load_orders(const string &path, std::ostream &errors)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        errors << "Cannot read simulated orders from " << path << endl;
+        return false;
+    }
+
+    string line;
+    for (size_t line_number = 1; std::getline(file, line); line_number++)
+    {
+        if (!line.empty() && line.back() == '\r')
+        {
+            line.pop_back();
+        }
+        if (line.empty() || line[0] == '#' || line.rfind("Time", 0) == 0)
+        {
+            continue;
+        }
+
+        vector<string> fields;
+        std::stringstream stream(line);
+        for (string field; std::getline(stream, field, ',');)
+        {
+            fields.push_back(field);
+        }
+
+        uint64_t timestamp = 0;
+        uint64_t cancel_timestamp = 0;
+        Price price;
+        char *end = nullptr;
+        unsigned long shares = (fields.size() >= 5) ? strtoul(fields[4].c_str(), &end, 10) : 0;
+        bool valid = (fields.size() == 5 || fields.size() == 6) &&
+                     parse_time_of_day(fields[0], timestamp) &&
+                     !fields[1].empty() && fields[1].size() <= 8 &&
+                     (fields[2] == "B" || fields[2] == "S") &&
+                     parse_price(fields[3], price) &&
+                     !fields[4].empty() && *end == '\0' && shares > 0 && shares <= UINT32_MAX &&
+                     (fields.size() == 5 || (parse_time_of_day(fields[5], cancel_timestamp) && cancel_timestamp >= timestamp));
+        if (!valid)
+        {
+            errors << path << ":" << line_number << ": expected time,symbol,B|S,price,shares[,cancel time]: " << line << endl;
+            return false;
+        }
+        submit(fields[1], fields[2][0], price, (uint32_t)shares, timestamp, cancel_timestamp);
+    }
+    return true;
+}
+
+void MatchingSimulator::process_events(uint64_t timestamp, OrderBook &book, const InstrumentTable &i_table)
+{
+    while (!events.empty() && events.top().timestamp <= timestamp)
+    {
+        Event event = events.top();
+        events.pop();
+        SimulatedOrder &order = simulated_orders[event.order];
+        if (!event.cancel)
+        {
+            if (order.state == SimulatedOrderState::PENDING)
+            {
+                enter(event.order, event.timestamp, book, i_table);
+            }
+        }
+        else if (order.state == SimulatedOrderState::PENDING)
+        {
+            // The cancel overtook the order on its way to the exchange.
+            order.state = SimulatedOrderState::CANCELLED;
+        }
+        else if (order.state == SimulatedOrderState::RESTING)
+        {
+            book.cancel_synthetic_order(order.handle);
+            resting_orders.erase(order.handle);
+            order.state = SimulatedOrderState::CANCELLED;
+        }
+    }
+}
+
+void MatchingSimulator::enter(uint32_t order_id, uint64_t timestamp, OrderBook &book, const InstrumentTable &i_table)
+{
+    SimulatedOrder &order = simulated_orders[order_id];
+    order.entry_timestamp = timestamp;
+    uint16_t stock_locate = i_table.find_stock_locate(order.stock);
+    if (stock_locate == 0)
+    {
+        order.state = SimulatedOrderState::REJECTED;
+        return;
+    }
+
+    // NO_ORDER means the order was marketable for all its shares and filled on entry.
+    order.handle = book.add_synthetic_order(stock_locate, order.side, order.price, order.shares);
+    order.state = SimulatedOrderState::RESTING;
+    if (order.handle != NO_ORDER)
+    {
+        resting_orders[order.handle] = order_id;
+    }
+    collect_fills(timestamp, book, order_id);
+}
+
+void MatchingSimulator::collect_fills(uint64_t timestamp, OrderBook &book, uint32_t entering_order)
+{
+    book.take_synthetic_fills(book_fills);
+    for (const SyntheticFill &fill : book_fills)
+    {
+        uint32_t order_id = entering_order;
+        if (fill.handle != NO_ORDER)
+        {
+            auto it = resting_orders.find(fill.handle);
+            if (it == resting_orders.end())
+            {
+                continue;
+            }
+            order_id = it->second;
+        }
+        else if (entering_order == UINT32_MAX)
+        {
+            continue;
+        }
+        SimulatedOrder &order = simulated_orders[order_id];
+        simulated_fills.push_back({.order = order_id,
+                                   .timestamp = timestamp,
+                                   .report_timestamp = timestamp + delay(latency.fill_report),
+                                   .price = fill.price,
+                                   .shares = fill.shares,
+                                   .liquidity = fill.liquidity});
+        if (order.filled_shares == 0)
+        {
+            order.first_fill_timestamp = timestamp;
+        }
+        order.filled_shares += fill.shares;
+        if (fill.remaining == 0)
+        {
+            order.state = SimulatedOrderState::FILLED;
+            resting_orders.erase(fill.handle);
+        }
+    }
+}
+
+bool MatchingSimulator::write_fills(const string &path) const
+{
+    std::ofstream file(path);
+    file << "Order,Symbol,Side,Price,Shares,Liquidity,Fill Time,Report Time" << endl;
+    for (const SimulatedFill &fill : simulated_fills)
+    {
+        const SimulatedOrder &order = simulated_orders[fill.order];
+        file << fill.order << ","
+             << order.stock.substr(0, order.stock.find_last_not_of(' ') + 1) << ","
+             << order.side << ","
+             << fill.price << ","
+             << fill.shares << ","
+             << fill.liquidity << ","
+             << format_timestamp(fill.timestamp) << ","
+             << format_timestamp(fill.report_timestamp) << endl;
+    }
+    file.close();
+    return (bool)file;
+}
+
+void MatchingSimulator::print_summary(std::ostream &os) const
+{
+    size_t counts[5] = {};
+    uint64_t submitted_shares = 0;
+    uint64_t filled_shares = 0;
+    size_t partially_filled = 0;
+    size_t first_fills = 0;
+    uint64_t time_to_first_fill = 0;
+    for (const SimulatedOrder &order : simulated_orders)
+    {
+        switch (order.state)
+        {
+        case SimulatedOrderState::PENDING:
+            counts[0]++;
+            break;
+        case SimulatedOrderState::RESTING:
+            counts[1]++;
+            break;
+        case SimulatedOrderState::FILLED:
+            counts[2]++;
+            break;
+        case SimulatedOrderState::CANCELLED:
+            counts[3]++;
+            break;
+        case SimulatedOrderState::REJECTED:
+            counts[4]++;
+            break;
+        }
+        submitted_shares += order.shares;
+        filled_shares += order.filled_shares;
+        if (order.filled_shares > 0)
+        {
+            partially_filled += (order.filled_shares < order.shares) ? 1 : 0;
+            first_fills++;
+            time_to_first_fill += order.first_fill_timestamp - order.entry_timestamp;
+        }
+    }
+
+    os << "Simulated orders: " << simulated_orders.size() << endl;
+    os << "Pending,Resting,Filled,Cancelled,Rejected,Partially filled" << endl;
+    os << counts[0] << "," << counts[1] << "," << counts[2] << "," << counts[3] << "," << counts[4] << "," << partially_filled << endl;
+    os << "Fills: " << simulated_fills.size() << ", filled shares: " << filled_shares << " of " << submitted_shares;
+    if (submitted_shares > 0)
+    {
+        os << " (" << std::fixed << std::setprecision(2) << 100.0 * filled_shares / submitted_shares << "%)";
+        os.unsetf(std::ios::floatfield);
+    }
+    os << endl;
+    if (first_fills > 0)
+    {
+        os << "Mean time from entry to first fill: " << time_to_first_fill / first_fills / 1000 << " us" << endl;
+    }
+}
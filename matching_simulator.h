@@ -0,0 +1,162 @@
+#ifndef MATCHING_SIMULATOR_H
+#define MATCHING_SIMULATOR_H
+
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <queue>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "instrument_table.h"
+#include "order_book.h"
+using namespace std;
+
+// Delays applied to simulated orders, in nanoseconds of exchange time. Each
+// delay gets a uniform random extra of up to jitter.
+struct LatencyModel
+{
+    // From the strategy's decision to the order resting on the exchange.
+    uint64_t order_entry;
+    // From the decision to cancel to the cancel taking effect.
+    uint64_t cancel;
+    // From the execution on the exchange to the strategy learning about it.
+    uint64_t fill_report;
+    uint64_t jitter;
+};
+
+enum class SimulatedOrderState : char
+{
+    // Submitted, still travelling to the exchange.
+    PENDING = 'P',
+    RESTING = 'A',
+    FILLED = 'F',
+    CANCELLED = 'C',
+    // The symbol was unknown when the order reached the exchange.
+    REJECTED = 'R'
+};
+
+struct SimulatedOrder
+{
+    // Padded to the 8 character ITCH stock field.
+    string stock;
+    char side;
+    Price price;
+    uint32_t shares;
+    uint64_t submit_timestamp;
+    // 0 if the strategy never cancels the order.
+    uint64_t cancel_timestamp;
+    uint64_t entry_timestamp;
+    uint64_t first_fill_timestamp;
+    uint32_t filled_shares;
+    // OrderBook handle while the order rests; NO_ORDER if it filled completely on entry.
+    uint32_t handle;
+    SimulatedOrderState state;
+};
+
+struct SimulatedFill
+{
+    uint32_t order;
+    // Exchange time of the execution, and when the strategy hears of it.
+    uint64_t timestamp;
+    uint64_t report_timestamp;
+    Price price;
+    uint32_t shares;
+    // 'A' filled while resting, 'R' marketable on entry.
+    char liquidity;
+};
+
+// Backtests hypothetical orders against a replayed capture. Orders are entered
+// into the replay's OrderBook as synthetic orders, so they queue behind the real
+// orders already at their price and ahead of later ones, in the same pooled
+// records and level queues, and are filled when real executions reach them (see
+// OrderBook::fill_synthetic_ahead). The real book is never changed: synthetic
+// orders stay out of its level counts and volumes.
+//
+// Hidden-order trades ('P') do not fill synthetic orders, since ITCH does not
+// say which side of them was the aggressor.
+class MatchingSimulator
+{
+public:
+    explicit MatchingSimulator(const LatencyModel &latency, uint64_t seed = 1) : latency(latency), rng(seed) {}
+
+    // Queues an order decided at timestamp; it reaches the book order_entry later.
+    uint32_t submit(const string &symbol, char side, Price price, uint32_t shares, uint64_t timestamp, uint64_t cancel_timestamp = 0);
+
+    // Reads orders to submit from a CSV file of lines
+    //     time,symbol,side,price,shares[,cancel time]
+    // with times as HH:MM:SS[.fraction] and the price in dollars. Blank lines,
+    // lines starting with '#' and a header line starting with "Time" are skipped.
+    // Returns false, naming the line, if the file cannot be read or a line is invalid.
+    bool load_orders(const string &path, std::ostream &errors = std::cerr);
+
+    // Called with the timestamp of each message before it is applied to book:
+    // enters and cancels the orders whose latency has elapsed.
+    void advance(uint64_t timestamp, OrderBook &book, const InstrumentTable &i_table)
+    {
+        if (!events.empty() && events.top().timestamp <= timestamp)
+        {
+            process_events(timestamp, book, i_table);
+        }
+    }
+
+    // Called after each message is applied to book: collects the fills it caused.
+    void on_frame_applied(uint64_t timestamp, OrderBook &book)
+    {
+        if (resting_orders.size() > 0)
+        {
+            collect_fills(timestamp, book);
+        }
+    }
+
+    const vector<SimulatedOrder> &orders() const
+    {
+        return simulated_orders;
+    }
+
+    const vector<SimulatedFill> &fills() const
+    {
+        return simulated_fills;
+    }
+
+    // Writes every fill as CSV. Returns false if the file cannot be written.
+    bool write_fills(const string &path) const;
+
+    void print_summary(std::ostream &os = std::cout) const;
+
+private:
+    struct Event
+    {
+        uint64_t timestamp;
+        uint32_t order;
+        bool cancel;
+
+        bool operator>(const Event &other) const
+        {
+            return timestamp > other.timestamp;
+        }
+    };
+
+    LatencyModel latency;
+    std::mt19937_64 rng;
+    vector<SimulatedOrder> simulated_orders;
+    vector<SimulatedFill> simulated_fills;
+    std::priority_queue<Event, vector<Event>, std::greater<Event>> events;
+    // OrderBook handle to simulated order, for the orders resting in the book.
+    unordered_map<uint32_t, uint32_t> resting_orders;
+    vector<SyntheticFill> book_fills;
+
+    uint64_t delay(uint64_t base)
+    {
+        return base + ((latency.jitter > 0) ? std::uniform_int_distribution<uint64_t>(0, latency.jitter)(rng) : 0);
+    }
+
+    void process_events(uint64_t timestamp, OrderBook &book, const InstrumentTable &i_table);
+    void enter(uint32_t order, uint64_t timestamp, OrderBook &book, const InstrumentTable &i_table);
+    // entering_order is the order being entered, if any: fills of an order that
+    // filled completely on entry carry NO_ORDER instead of a handle.
+    void collect_fills(uint64_t timestamp, OrderBook &book, uint32_t entering_order = UINT32_MAX);
+};
+
+#endif // MATCHING_SIMULATOR_H
@@ -0,0 +1,268 @@
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <linux/mempolicy.h>
+#include <linux/perf_event.h>
+#include "memory_policy.h"
+
+constexpr size_t NORMAL_PAGE = 4096;
+constexpr size_t HUGE_PAGE = 2 << 20;
+constexpr size_t GIGANTIC_PAGE = 1 << 30;
+
+static MemoryPolicy memory_policy = {.huge_pages = false, .gigantic_pages = false, .numa_node = -1};
+
+// munmap needs the length that was mapped, which depends on the page size picked.
+static std::mutex mappings_mutex;
+static unordered_map<void *, size_t> mappings;
+static MemoryPolicyStats stats = {};
+
+void set_memory_policy(const MemoryPolicy &policy)
+{
+    memory_policy = policy;
+}
+
+const MemoryPolicy &get_memory_policy()
+{
+    return memory_policy;
+}
+
+MemoryPolicyStats get_memory_policy_stats()
+{
+    std::lock_guard<std::mutex> lock(mappings_mutex);
+    return stats;
+}
+
+void print_memory_policy_stats(std::ostream &os)
+{
+    MemoryPolicyStats current = get_memory_policy_stats();
+    os << "Large allocations: " << std::dec
+       << current.gigantic_page_bytes << " bytes on 1 GB pages, "
+       << current.huge_page_bytes << " on 2 MB pages, "
+       << current.transparent_page_bytes << " on transparent huge pages, "
+       << current.normal_page_bytes << " on normal pages";
+    if (current.bind_failures > 0)
+    {
+        os << " (" << current.bind_failures << " could not be bound to node " << memory_policy.numa_node << ")";
+    }
+    os << std::endl;
+}
+
+static size_t round_up(size_t bytes, size_t page)
+{
+    return (bytes + page - 1) / page * page;
+}
+
+static void *map_anonymous(size_t length, int flags)
+{
+    void *pointer = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | flags, -1, 0);
+    return (pointer == MAP_FAILED) ? nullptr : pointer;
+}
+
+static bool bind_to_node(void *pointer, size_t length, int node)
+{
+    unsigned long node_mask[16] = {};
+    if (node < 0 || node >= (int)(sizeof(node_mask) * 8))
+    {
+        return false;
+    }
+    node_mask[node / (8 * sizeof(unsigned long))] |= 1ul << (node % (8 * sizeof(unsigned long)));
+
+    // Preferred rather than strict binding, so a full node spills over instead of failing.
+    return syscall(SYS_mbind, pointer, length, MPOL_PREFERRED, node_mask, sizeof(node_mask) * 8, 0) == 0;
+}
+
+void *allocate_large(size_t bytes)
+{
+    void *pointer = nullptr;
+    size_t length = 0;
+    uint64_t MemoryPolicyStats::*counter = &MemoryPolicyStats::normal_page_bytes;
+
+    if (memory_policy.huge_pages)
+    {
+        // A 1 GB page is only worth it when most of it is used.
+        if (memory_policy.gigantic_pages && bytes >= GIGANTIC_PAGE / 2)
+        {
+            length = round_up(bytes, GIGANTIC_PAGE);
+            pointer = map_anonymous(length, MAP_HUGETLB | (30 << MAP_HUGE_SHIFT));
+            counter = &MemoryPolicyStats::gigantic_page_bytes;
+        }
+        if (pointer == nullptr)
+        {
+            length = round_up(bytes, HUGE_PAGE);
+            pointer = map_anonymous(length, MAP_HUGETLB | (21 << MAP_HUGE_SHIFT));
+            counter = &MemoryPolicyStats::huge_page_bytes;
+        }
+        if (pointer == nullptr)
+        {
+            length = round_up(bytes, HUGE_PAGE);
+            pointer = map_anonymous(length, 0);
+            bool transparent = pointer != nullptr && madvise(pointer, length, MADV_HUGEPAGE) == 0;
+            counter = transparent ? &MemoryPolicyStats::transparent_page_bytes : &MemoryPolicyStats::normal_page_bytes;
+        }
+    }
+    else
+    {
+        length = round_up(bytes, NORMAL_PAGE);
+        pointer = map_anonymous(length, 0);
+    }
+
+    if (pointer == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+
+    // Binding happens before the first touch, so the pages are faulted in on the node.
+    bool bound = memory_policy.numa_node < 0 || bind_to_node(pointer, length, memory_policy.numa_node);
+
+    std::lock_guard<std::mutex> lock(mappings_mutex);
+    mappings[pointer] = length;
+    stats.*counter += length;
+    stats.bind_failures += !bound;
+    return pointer;
+}
+
+void free_large(void *pointer, size_t bytes)
+{
+    size_t length = round_up(bytes, NORMAL_PAGE);
+    {
+        std::lock_guard<std::mutex> lock(mappings_mutex);
+        auto it = mappings.find(pointer);
+        if (it != mappings.end())
+        {
+            length = it->second;
+            mappings.erase(it);
+        }
+    }
+    munmap(pointer, length);
+}
+
+bool pin_current_thread(int cpu)
+{
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) == 0;
+}
+
+int cpu_numa_node(int cpu)
+{
+    string path = "/sys/devices/system/cpu/cpu" + std::to_string(cpu);
+    DIR *directory = opendir(path.c_str());
+    if (directory == nullptr)
+    {
+        return -1;
+    }
+
+    int node = -1;
+    while (struct dirent *entry = readdir(directory))
+    {
+        if (strncmp(entry->d_name, "node", 4) == 0 && isdigit((unsigned char)entry->d_name[4]))
+        {
+            node = atoi(&entry->d_name[4]);
+            break;
+        }
+    }
+    closedir(directory);
+    return node;
+}
+
+static int open_counter(uint32_t type, uint64_t config)
+{
+    perf_event_attr attributes = {};
+    attributes.size = sizeof(attributes);
+    attributes.type = type;
+    attributes.config = config;
+    attributes.disabled = 1;
+    attributes.exclude_kernel = 1;
+    attributes.exclude_hv = 1;
+
+    // Counts the calling thread only, which is the one doing the replay.
+    return (int)syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0);
+}
+
+static uint64_t read_counter(int fd)
+{
+    uint64_t value = 0;
+    return (fd >= 0 && read(fd, &value, sizeof(value)) == sizeof(value)) ? value : 0;
+}
+
+TlbCounters::TlbCounters()
+{
+    dtlb_fd = open_counter(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB |
+                                                   (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                                   (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+    instructions_fd = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+}
+
+TlbCounters::~TlbCounters()
+{
+    if (dtlb_fd >= 0)
+    {
+        close(dtlb_fd);
+    }
+    if (instructions_fd >= 0)
+    {
+        close(instructions_fd);
+    }
+}
+
+bool TlbCounters::available() const
+{
+    return dtlb_fd >= 0;
+}
+
+void TlbCounters::start()
+{
+    for (int fd : {dtlb_fd, instructions_fd})
+    {
+        if (fd >= 0)
+        {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+}
+
+void TlbCounters::stop()
+{
+    for (int fd : {dtlb_fd, instructions_fd})
+    {
+        if (fd >= 0)
+        {
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+    dtlb_misses = read_counter(dtlb_fd);
+    instructions = read_counter(instructions_fd);
+}
+
+void TlbCounters::print_report(uint64_t messages, std::ostream &os) const
+{
+    if (!available())
+    {
+        os << "dTLB load misses: unavailable (perf events not permitted)" << std::endl;
+        return;
+    }
+
+    os << "dTLB load misses: " << std::dec << dtlb_misses;
+    if (messages > 0)
+    {
+        os << " (" << std::fixed << std::setprecision(3) << (double)dtlb_misses / messages << " per message)";
+    }
+    if (instructions > 0)
+    {
+        os << ", " << std::fixed << std::setprecision(3) << dtlb_misses * 1000.0 / instructions << " per 1000 instructions";
+    }
+    os << std::defaultfloat << std::endl;
+}
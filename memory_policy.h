@@ -0,0 +1,117 @@
+#ifndef MEMORY_POLICY_H
+#define MEMORY_POLICY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <new>
+using namespace std;
+
+// How large allocations (order records, price levels, the order index, the
+// trade book buckets and feed buffers) are backed. Set once, before the Replay
+// and FeedReader that should use it are constructed.
+struct MemoryPolicy
+{
+    // Try explicit 2 MB huge pages (needs pages reserved in vm.nr_hugepages), and
+    // fall back to transparent huge pages, then to normal pages.
+    bool huge_pages;
+    // Try 1 GB pages before 2 MB ones.
+    bool gigantic_pages;
+    // NUMA node large allocations are bound to, or -1 to leave placement to the kernel.
+    int numa_node;
+};
+
+// Page size that backed each large allocation, for the report.
+struct MemoryPolicyStats
+{
+    uint64_t gigantic_page_bytes;
+    uint64_t huge_page_bytes;
+    uint64_t transparent_page_bytes;
+    uint64_t normal_page_bytes;
+    uint64_t bind_failures;
+};
+
+void set_memory_policy(const MemoryPolicy &policy);
+const MemoryPolicy &get_memory_policy();
+MemoryPolicyStats get_memory_policy_stats();
+void print_memory_policy_stats(std::ostream &os = std::cout);
+
+// Allocations below this go through operator new: mapping them would waste most of a page.
+constexpr size_t LARGE_ALLOCATION_BYTES = 1 << 20;
+
+// Maps at least bytes according to the current policy. Never returns nullptr;
+// throws bad_alloc like operator new if nothing could be mapped.
+void *allocate_large(size_t bytes);
+void free_large(void *pointer, size_t bytes);
+
+// Pins the calling thread to cpu. Returns false if the affinity could not be set.
+bool pin_current_thread(int cpu);
+
+// NUMA node of cpu, or -1 if it cannot be determined.
+int cpu_numa_node(int cpu);
+
+// Stateless allocator for the large containers. Small requests, such as the
+// nodes of a hash map, still come from operator new.
+template <typename T>
+struct PolicyAllocator
+{
+    using value_type = T;
+
+    PolicyAllocator() = default;
+
+    template <typename U>
+    PolicyAllocator(const PolicyAllocator<U> &) {}
+
+    T *allocate(size_t count)
+    {
+        size_t bytes = count * sizeof(T);
+        if (bytes < LARGE_ALLOCATION_BYTES)
+        {
+            return static_cast<T *>(::operator new(bytes));
+        }
+        return static_cast<T *>(allocate_large(bytes));
+    }
+
+    void deallocate(T *pointer, size_t count)
+    {
+        size_t bytes = count * sizeof(T);
+        if (bytes < LARGE_ALLOCATION_BYTES)
+        {
+            ::operator delete(pointer);
+            return;
+        }
+        free_large(pointer, bytes);
+    }
+
+    template <typename U>
+    bool operator==(const PolicyAllocator<U> &) const
+    {
+        return true;
+    }
+};
+
+// Hardware counters read around a replay: data TLB load misses and instructions,
+// so that runs with and without huge pages can be compared.
+class TlbCounters
+{
+public:
+    TlbCounters();
+    ~TlbCounters();
+
+    TlbCounters(const TlbCounters &) = delete;
+    TlbCounters &operator=(const TlbCounters &) = delete;
+
+    // False when perf events are not permitted (see kernel.perf_event_paranoid).
+    bool available() const;
+    void start();
+    void stop();
+    void print_report(uint64_t messages, std::ostream &os = std::cout) const;
+
+private:
+    int dtlb_fd = -1;
+    int instructions_fd = -1;
+    uint64_t dtlb_misses = 0;
+    uint64_t instructions = 0;
+};
+
+#endif // MEMORY_POLICY_H
@@ -5,192 +5,928 @@
 #include <unordered_map>
 #include <iomanip>
 #include <vector>
-#include <cassert>
 #include "helper.h"
+#include "order_index.h"
+#include "book_snapshot.h"
+#include "memory_policy.h"
+#include "price_ladder.h"
+#include "symbol_state.h"
 using namespace std;
 
-struct OrderBookEntry
+constexpr uint16_t ORDER_FLAG_BUY = 1 << 0;
+// Added or replaced while a Reg SHO short sale restriction was in effect for the stock.
+constexpr uint16_t ORDER_FLAG_SHORT_SALE_RESTRICTED = 1 << 1;
+// A simulated order placed by a MatchingSimulator rather than by the feed.
+constexpr uint16_t ORDER_FLAG_SYNTHETIC = 1 << 2;
+
+// One live order, 24 bytes with no padding. The side is a bit in flags, and
+// prev/next are handles of the neighbouring orders in the same price level queue
+// (next also chains free records). level is the handle of that queue, so an order
+// can be unlinked or resized without looking its price up. The order reference
+// number lives only in the OrderIndex.
+struct OrderRecord
 {
-    char side;
-    uint16_t stock_locate;
-    uint32_t price;
+    Price price;
     uint32_t volume;
+    uint32_t prev;
+    uint32_t next;
+    uint32_t level;
+    uint16_t stock_locate;
+    uint16_t flags;
+};
+
+static_assert(sizeof(OrderRecord) == 24, "OrderRecord should stay packed");
+
+inline char order_side(const OrderRecord &order)
+{
+    return (order.flags & ORDER_FLAG_BUY) ? 'B' : 'S';
+}
+
+// FIFO queue of the orders resting at one price, oldest (first to fill) at head.
+// Synthetic orders queue with the real ones but are left out of order_count and
+// volume, which always describe the feed's book; a level holding only synthetic
+// orders has a count of 0 and is skipped by the depth and level readers.
+struct PriceLevel
+{
+    uint32_t head;
+    uint32_t tail;
+    uint32_t order_count;
+    Price price;
+    uint64_t volume;
+};
+
+// Price to level handle, best price first on both sides.
+struct StockBook
+{
+    PriceLadder bids = PriceLadder(true);
+    PriceLadder asks = PriceLadder(false);
+    // Synthetic orders resting on each side, so executions in stocks without any skip the queue walk.
+    uint32_t synthetic_bids = 0;
+    uint32_t synthetic_asks = 0;
+};
+
+struct QueuePosition
+{
+    uint32_t orders_ahead;
+    uint64_t shares_ahead;
+    uint32_t level_order_count;
+    uint64_t level_volume;
+};
+
+struct LevelCheck
+{
+    uint32_t levels;
+    uint32_t errors;
+    // No levels are left on this side after the ones checked.
+    bool done;
 };
 
 struct OrderBookByStockEntry
 {
     char side;
     uint64_t order_reference_number;
-    uint32_t price;
+    Price price;
     uint32_t volume;
+    bool short_sale_restricted;
+};
+
+// Shares of a synthetic order filled by a real execution. liquidity is 'A' when the
+// order was resting and 'R' when it was marketable on entry.
+struct SyntheticFill
+{
+    uint32_t handle;
+    uint32_t shares;
+    Price price;
+    // Shares still resting; the order is gone from the book once this is 0.
+    uint32_t remaining;
+    char liquidity;
 };
 
 struct ExecutedOrder
 {
     uint16_t stock_locate;
-    uint32_t price;
+    Price price;
     uint32_t volume;
     char cross_type;
 };
 
+enum class OrderBookResult
+{
+    OK,
+    ORDER_NOT_FOUND,
+    DUPLICATE_ORDER,
+    VOLUME_UNDERFLOW,
+    TRADE_MISMATCH,
+    TRADE_NOT_FOUND
+};
+
+constexpr size_t ORDER_BOOK_RESULT_COUNT = 6;
+
+inline const char *order_book_result_name(OrderBookResult result)
+{
+    switch (result)
+    {
+    case OrderBookResult::OK:
+        return "OK";
+    case OrderBookResult::ORDER_NOT_FOUND:
+        return "Order not found";
+    case OrderBookResult::DUPLICATE_ORDER:
+        return "Duplicate order";
+    case OrderBookResult::VOLUME_UNDERFLOW:
+        return "Volume underflow";
+    case OrderBookResult::TRADE_MISMATCH:
+        return "Trade mismatch";
+    case OrderBookResult::TRADE_NOT_FOUND:
+        return "Trade not found";
+    }
+    return "Unknown";
+}
+
 class OrderBook
 {
 private:
-    unordered_map<uint64_t, OrderBookEntry> order_book;
-    unordered_map<uint64_t, ExecutedOrder> trade_book;
+    vector<OrderRecord, PolicyAllocator<OrderRecord>> orders;
+    uint32_t free_orders = NO_ORDER;
+    OrderIndex order_index;
+    vector<PriceLevel, PolicyAllocator<PriceLevel>> levels;
+    uint32_t free_levels = NO_LEVEL;
+    vector<StockBook> stock_books;
+    vector<SymbolState> symbol_states;
+    // Price levels whose size changed since take_level_changes, with repeats, while tracking is on.
+    vector<uint64_t> changed_levels;
+    bool track_level_changes = false;
+    size_t synthetic_orders = 0;
+    vector<SyntheticFill> synthetic_fills;
+    vector<uint32_t> synthetic_candidates;
+    unordered_map<uint64_t, ExecutedOrder, hash<uint64_t>, equal_to<uint64_t>, PolicyAllocator<pair<const uint64_t, ExecutedOrder>>> trade_book;
 
-public:
-    void add_order(const AddOrderMessage &message)
-    {
-        OrderBookEntry entry = {
-            .side = message.buy_sell_indicator,
-            .stock_locate = message.header.stock_locate,
-            .price = message.price,
-            .volume = message.shares};
-        order_book[message.order_reference_number] = entry;
-    };
+    uint32_t allocate_order()
+    {
+        if (free_orders == NO_ORDER)
+        {
+            orders.emplace_back();
+            return (uint32_t)(orders.size() - 1);
+        }
+
+        uint32_t handle = free_orders;
+        free_orders = orders[handle].next;
+        return handle;
+    }
 
-    void delete_cancel_order(const DeleteCancelMessage &message)
+    void release_order(uint32_t handle)
     {
-        assert(order_book.find(message.order_reference_number) != order_book.end());
-        if (message.delete_cancel_indicator == 'D')
+        orders[handle].next = free_orders;
+        free_orders = handle;
+    }
+
+    SymbolState &mutable_symbol_state(uint16_t stock_locate)
+    {
+        if (stock_locate >= symbol_states.size())
+        {
+            symbol_states.resize(stock_locate + 1, SymbolState{});
+        }
+        return symbol_states[stock_locate];
+    }
+
+    uint16_t short_sale_flag(uint16_t stock_locate) const
+    {
+        return (symbol_state(stock_locate).flags & SYMBOL_SHORT_SALE_RESTRICTED) ? ORDER_FLAG_SHORT_SALE_RESTRICTED : 0;
+    }
+
+    StockBook &stock_book(uint16_t stock_locate)
+    {
+        if (stock_locate >= stock_books.size())
         {
-            order_book.erase(message.order_reference_number);
+            stock_books.resize(stock_locate + 1);
         }
-        else if (message.delete_cancel_indicator == 'C')
+        return stock_books[stock_locate];
+    }
+
+    void note_level_change(const OrderRecord &order)
+    {
+        if (track_level_changes)
         {
-            order_book[message.order_reference_number].volume -= message.cancelled_shares;
+            changed_levels.push_back(level_key(order.stock_locate, order_side(order), order.price));
         }
+    }
 
-        if (order_book[message.order_reference_number].volume == 0)
+    uint32_t allocate_level(Price price)
+    {
+        uint32_t handle;
+        if (free_levels == NO_LEVEL)
+        {
+            levels.emplace_back();
+            handle = (uint32_t)(levels.size() - 1);
+        }
+        else
         {
-            order_book.erase(message.order_reference_number);
+            handle = free_levels;
+            free_levels = levels[handle].head;
         }
 
+        levels[handle] = {
+            .head = NO_ORDER,
+            .tail = NO_ORDER,
+            .order_count = 0,
+            .price = price,
+            .volume = 0};
+        return handle;
     }
 
-    void relpace_order(const ReplaceOrderMessage &message)
+    void release_level(const OrderRecord &order)
     {
-        assert(order_book.find(message.original_order_reference_number) != order_book.end());
-        assert(order_book.find(message.new_order_reference_number) == order_book.end());
-        OrderBookEntry new_entry = {
-            .side = order_book[message.original_order_reference_number].side,
-            .stock_locate = message.header.stock_locate,
-            .price = message.price,
-            .volume = message.shares};
+        StockBook &book = stock_books[order.stock_locate];
+        PriceLadder &ladder = (order.flags & ORDER_FLAG_BUY) ? book.bids : book.asks;
+        ladder.erase(order.price);
 
-        order_book[message.new_order_reference_number] = new_entry;
-        order_book.erase(message.original_order_reference_number);
+        levels[order.level].head = free_levels;
+        free_levels = order.level;
     }
 
-    void execute_order(const OrderExecutedMessage &message)
+    // Level at the order's price, created empty if this is the first order there.
+    uint32_t find_or_add_level(const OrderRecord &order)
     {
-        assert(order_book.find(message.order_reference_number) != order_book.end());
-        order_book[message.order_reference_number].volume -= message.executed_shares;
+        StockBook &book = stock_book(order.stock_locate);
+        PriceLadder &ladder = (order.flags & ORDER_FLAG_BUY) ? book.bids : book.asks;
+        uint32_t level = ladder.find(order.price);
+        if (level == NO_LEVEL)
+        {
+            level = allocate_level(order.price);
+            ladder.insert(order.price, level);
+        }
+        return level;
+    }
 
-        if (trade_book.find(message.match_number) == trade_book.end())
+    // Appends the order to the back of the queue at its price: a new or replaced
+    // order always has the lowest time priority.
+    void link_order(uint32_t handle)
+    {
+        uint32_t level_handle = find_or_add_level(orders[handle]);
+        OrderRecord &order = orders[handle];
+        PriceLevel &level = levels[level_handle];
+
+        order.level = level_handle;
+        order.prev = level.tail;
+        order.next = NO_ORDER;
+        if (level.tail != NO_ORDER)
+        {
+            orders[level.tail].next = handle;
+        }
+        else
+        {
+            level.head = handle;
+        }
+        level.tail = handle;
+        if (!(order.flags & ORDER_FLAG_SYNTHETIC))
         {
-            ExecutedOrder order = {
-                .stock_locate = message.header.stock_locate,
-                .price = order_book[message.order_reference_number].price,
-                .volume = message.executed_shares,
-                .cross_type = ' '};
+            level.order_count++;
+            level.volume += order.volume;
+            note_level_change(order);
+        }
+    }
 
-            trade_book[message.match_number] = order;
+    void unlink_order(uint32_t handle)
+    {
+        OrderRecord &order = orders[handle];
+        PriceLevel &level = levels[order.level];
+
+        if (order.prev != NO_ORDER)
+        {
+            orders[order.prev].next = order.next;
+        }
+        else
+        {
+            level.head = order.next;
+        }
+        if (order.next != NO_ORDER)
+        {
+            orders[order.next].prev = order.prev;
         }
         else
         {
-            trade_book[message.match_number].volume += message.executed_shares;
+            level.tail = order.prev;
+        }
+        if (!(order.flags & ORDER_FLAG_SYNTHETIC))
+        {
+            level.order_count--;
+            level.volume -= order.volume;
+            note_level_change(order);
         }
 
-        if (order_book[message.order_reference_number].volume == 0)
+        if (level.head == NO_ORDER)
         {
-            order_book.erase(message.order_reference_number);
+            release_level(order);
         }
     }
 
-    void execute_order_price(const OrderExecutedPriceMessage &message)
+    void remove_order(size_t slot, uint32_t handle)
     {
-        if (message.printable)
+        unlink_order(handle);
+        release_order(handle);
+        order_index.erase_at(slot);
+    }
+
+    // Removes shares from the order found at slot, removing it once nothing is left.
+    // The slot is the one found by the caller so the order is never probed twice.
+    OrderBookResult reduce_order(size_t slot, uint32_t shares)
+    {
+        uint32_t handle = order_index.handle_at(slot);
+        OrderRecord &order = orders[handle];
+        if (shares < order.volume)
         {
-            assert(order_book.find(message.order_reference_number) != order_book.end());
-            order_book[message.order_reference_number].volume -= message.executed_shares;
+            // Partial executions and cancels keep the order's place in the queue.
+            order.volume -= shares;
+            levels[order.level].volume -= shares;
+            note_level_change(order);
+            return OrderBookResult::OK;
+        }
+
+        OrderBookResult result = (shares == order.volume) ? OrderBookResult::OK : OrderBookResult::VOLUME_UNDERFLOW;
+        remove_order(slot, handle);
+        return result;
+    }
 
-            if (trade_book.find(message.match_number) == trade_book.end())
+    void fill_synthetic(uint32_t handle, uint32_t shares, Price price, char liquidity)
+    {
+        OrderRecord &order = orders[handle];
+        order.volume -= shares;
+        synthetic_fills.push_back({.handle = handle, .shares = shares, .price = price, .remaining = order.volume, .liquidity = liquidity});
+        if (order.volume == 0)
+        {
+            count_synthetic(order, -1);
+            unlink_order(handle);
+            release_order(handle);
+        }
+    }
+
+    void count_synthetic(const OrderRecord &order, int delta)
+    {
+        StockBook &book = stock_books[order.stock_locate];
+        uint32_t &count = (order.flags & ORDER_FLAG_BUY) ? book.synthetic_bids : book.synthetic_asks;
+        count += delta;
+        synthetic_orders += delta;
+    }
+
+    bool has_synthetic_orders(uint32_t handle) const
+    {
+        const OrderRecord &order = orders[handle];
+        const StockBook &book = stock_books[order.stock_locate];
+        return ((order.flags & ORDER_FLAG_BUY) ? book.synthetic_bids : book.synthetic_asks) > 0;
+    }
+
+    // A real execution of the order at handle: the synthetic orders that would have
+    // traded before it, at better prices on its side or ahead of it in its queue,
+    // are filled at their own prices out of the executed shares.
+    void fill_synthetic_ahead(uint32_t handle, uint32_t shares)
+    {
+        const OrderRecord &executed = orders[handle];
+        bool buy = executed.flags & ORDER_FLAG_BUY;
+        Price executed_price = executed.price;
+        const PriceLadder &ladder = buy ? stock_books[executed.stock_locate].bids : stock_books[executed.stock_locate].asks;
+
+        // Collected first, since a fill can release a level while the ladder is walked.
+        vector<uint32_t> &candidates = synthetic_candidates;
+        candidates.clear();
+        ladder.for_each([&](Price price, uint32_t level_handle)
+                        {
+            if (buy ? price <= executed_price : price >= executed_price)
+            {
+                return false;
+            }
+            for (uint32_t ahead = levels[level_handle].head; ahead != NO_ORDER; ahead = orders[ahead].next)
             {
-                ExecutedOrder order = {
-                    .stock_locate = message.header.stock_locate,
-                    .price = message.execution_price,
-                    .volume = message.executed_shares,
-                    .cross_type = ' '};
+                if (orders[ahead].flags & ORDER_FLAG_SYNTHETIC)
+                {
+                    candidates.push_back(ahead);
+                }
+            }
+            return true; });
+        for (uint32_t ahead = levels[executed.level].head; ahead != handle; ahead = orders[ahead].next)
+        {
+            if (orders[ahead].flags & ORDER_FLAG_SYNTHETIC)
+            {
+                candidates.push_back(ahead);
+            }
+        }
 
-                trade_book[message.match_number] = order;
+        for (uint32_t candidate : candidates)
+        {
+            if (shares == 0)
+            {
+                break;
             }
-            else
+            uint32_t filled = std::min(shares, orders[candidate].volume);
+            fill_synthetic(candidate, filled, orders[candidate].price, 'A');
+            shares -= filled;
+        }
+    }
+
+    OrderBookResult record_trade(uint64_t match_number, uint16_t stock_locate, Price price, uint32_t shares, char cross_type)
+    {
+        ExecutedOrder order = {
+            .stock_locate = stock_locate,
+            .price = price,
+            .volume = shares,
+            .cross_type = cross_type};
+
+        auto [it, inserted] = trade_book.try_emplace(match_number, order);
+        if (inserted)
+        {
+            return OrderBookResult::OK;
+        }
+
+        it->second.volume += shares;
+        if (it->second.price != price || it->second.stock_locate != stock_locate)
+        {
+            return OrderBookResult::TRADE_MISMATCH;
+        }
+        return OrderBookResult::OK;
+    }
+
+    uint32_t copy_depth(const PriceLadder &ladder, DepthLevel *depth, uint32_t max_levels) const
+    {
+        uint32_t count = 0;
+        if (max_levels == 0)
+        {
+            return 0;
+        }
+        ladder.for_each([&](Price, uint32_t level_handle)
+                        {
+            const PriceLevel &level = levels[level_handle];
+            if (level.order_count == 0)
+            {
+                return true;
+            }
+            depth[count++] = {
+                .price = level.price,
+                .order_count = level.order_count,
+                .volume = level.volume};
+            return count < max_levels; });
+        return count;
+    }
+
+    LevelCheck check_side(const PriceLadder &ladder, uint16_t stock_locate, uint16_t side_flag, Price &next_price, uint32_t max_levels) const
+    {
+        LevelCheck check = {.levels = 0, .errors = 0, .done = true};
+        ladder.for_each_from(next_price, [&](Price price, uint32_t level_handle)
+                             {
+            if (check.levels == max_levels)
             {
-                trade_book[message.match_number].volume += message.executed_shares;
+                // Stop here and resume from this level next time.
+                next_price = price;
+                check.done = false;
+                return false;
             }
+            check.levels++;
+            const PriceLevel &level = levels[level_handle];
+            uint32_t count = 0;
+            uint32_t walked = 0;
+            uint64_t volume = 0;
+            uint32_t prev = NO_ORDER;
 
-            if (order_book[message.order_reference_number].volume == 0)
+            // Bounded by the real and synthetic orders in the book so a corrupt chain cannot loop forever.
+            for (uint32_t handle = level.head; handle < orders.size() && walked <= level.order_count + synthetic_orders; handle = orders[handle].next)
             {
-                order_book.erase(message.order_reference_number);
+                const OrderRecord &order = orders[handle];
+                if (order.prev != prev || order.level != level_handle || order.price != price ||
+                    order.stock_locate != stock_locate || (order.flags & ORDER_FLAG_BUY) != side_flag || order.volume == 0)
+                {
+                    check.errors++;
+                }
+                prev = handle;
+                walked++;
+                if (!(order.flags & ORDER_FLAG_SYNTHETIC))
+                {
+                    count++;
+                    volume += order.volume;
+                }
             }
+
+            if (level.price != price || level.tail != prev || walked == 0 || count != level.order_count || volume != level.volume)
+            {
+                check.errors++;
+            }
+            return true; });
+        return check;
+    }
+
+public:
+    OrderBookResult add_order(const AddOrderMessage &message)
+    {
+        uint32_t handle = allocate_order();
+        if (!order_index.insert(message.order_reference_number, handle))
+        {
+            release_order(handle);
+            return OrderBookResult::DUPLICATE_ORDER;
+        }
+
+        OrderRecord &order = orders[handle];
+        order.price = message.price;
+        order.volume = message.shares;
+        order.stock_locate = message.header.stock_locate;
+        order.flags = ((message.buy_sell_indicator == 'B') ? ORDER_FLAG_BUY : 0) | short_sale_flag(order.stock_locate);
+        link_order(handle);
+        return OrderBookResult::OK;
+    };
+
+    OrderBookResult delete_cancel_order(const DeleteCancelMessage &message)
+    {
+        size_t slot = order_index.find(message.order_reference_number);
+        if (slot == OrderIndex::NOT_FOUND)
+        {
+            return OrderBookResult::ORDER_NOT_FOUND;
+        }
+
+        if (message.delete_cancel_indicator == 'D')
+        {
+            remove_order(slot, order_index.handle_at(slot));
+            return OrderBookResult::OK;
         }
+        return reduce_order(slot, message.cancelled_shares);
     }
 
-    void execute_cross_trade(const TradeCrossMessage &message)
+    OrderBookResult relpace_order(const ReplaceOrderMessage &message)
     {
-        if (trade_book.find(message.match_number) == trade_book.end())
+        size_t slot = order_index.find(message.original_order_reference_number);
+        if (slot == OrderIndex::NOT_FOUND)
         {
-            ExecutedOrder order = {
-                .stock_locate = message.header.stock_locate,
-                .price = message.cross_price,
-                .volume = message.shares,
-                .cross_type = message.cross_type};
-            trade_book[message.match_number] = order;
+            return OrderBookResult::ORDER_NOT_FOUND;
         }
-        else
+
+        // The record is reused for the new reference; erase before inserting
+        // since an insert may grow the index and move slots around.
+        uint32_t handle = order_index.handle_at(slot);
+        unlink_order(handle);
+        order_index.erase_at(slot);
+        if (!order_index.insert(message.new_order_reference_number, handle))
         {
-            assert(trade_book[message.match_number].price == message.cross_price);
-            assert(trade_book[message.match_number].stock_locate == message.header.stock_locate);
-            trade_book[message.match_number].volume += message.shares;
+            release_order(handle);
+            return OrderBookResult::DUPLICATE_ORDER;
         }
+
+        OrderRecord &order = orders[handle];
+        order.price = message.price;
+        order.volume = message.shares;
+        order.stock_locate = message.header.stock_locate;
+        order.flags = (order.flags & ORDER_FLAG_BUY) | short_sale_flag(order.stock_locate);
+        link_order(handle);
+        return OrderBookResult::OK;
     }
 
-    void execute_non_cross_trade(const TradeNonCrossMessage &message)
+    OrderBookResult execute_order(const OrderExecutedMessage &message)
     {
-        if (trade_book.find(message.match_number) == trade_book.end())
+        size_t slot = order_index.find(message.order_reference_number);
+        if (slot == OrderIndex::NOT_FOUND)
         {
-            ExecutedOrder order = {
-                .stock_locate = message.header.stock_locate,
-                .price = message.price,
-                .volume = message.shares,
-                .cross_type = ' '};
-            trade_book[message.match_number] = order;
+            return OrderBookResult::ORDER_NOT_FOUND;
         }
-        else
+
+        uint32_t handle = order_index.handle_at(slot);
+        Price price = orders[handle].price;
+        if (synthetic_orders > 0 && has_synthetic_orders(handle))
         {
-            assert(trade_book[message.match_number].price == message.price);
-            assert(trade_book[message.match_number].stock_locate == message.header.stock_locate);
-            trade_book[message.match_number].volume += message.shares;
+            fill_synthetic_ahead(handle, message.executed_shares);
         }
+        OrderBookResult trade_result = record_trade(message.match_number, message.header.stock_locate, price, message.executed_shares, ' ');
+        OrderBookResult order_result = reduce_order(slot, message.executed_shares);
+        return (order_result != OrderBookResult::OK) ? order_result : trade_result;
     }
 
-    void get_orders_by_stock_locate(uint16_t stock_locate, vector<OrderBookByStockEntry> &entries)
+    OrderBookResult execute_order_price(const OrderExecutedPriceMessage &message)
     {
-        for (const auto [key, entry] : order_book)
+        size_t slot = order_index.find(message.order_reference_number);
+        if (slot == OrderIndex::NOT_FOUND)
         {
-            if (entry.stock_locate == stock_locate)
+            return OrderBookResult::ORDER_NOT_FOUND;
+        }
+
+        if (synthetic_orders > 0 && has_synthetic_orders(order_index.handle_at(slot)))
+        {
+            fill_synthetic_ahead(order_index.handle_at(slot), message.executed_shares);
+        }
+
+        // Non-printable executions still consume the resting order, they are just not counted as trades.
+        OrderBookResult trade_result = OrderBookResult::OK;
+        if (message.printable)
+        {
+            trade_result = record_trade(message.match_number, message.header.stock_locate, message.execution_price, message.executed_shares, ' ');
+        }
+        OrderBookResult order_result = reduce_order(slot, message.executed_shares);
+        return (order_result != OrderBookResult::OK) ? order_result : trade_result;
+    }
+
+    OrderBookResult execute_cross_trade(const TradeCrossMessage &message)
+    {
+        return record_trade(message.match_number, message.header.stock_locate, message.cross_price, (uint32_t)message.shares, message.cross_type);
+    }
+
+    OrderBookResult execute_non_cross_trade(const TradeNonCrossMessage &message)
+    {
+        return record_trade(message.match_number, message.header.stock_locate, message.price, message.shares, ' ');
+    }
+
+    // A broken trade is reversed by dropping its match from the trade book; resting orders are not restored.
+    OrderBookResult break_trade(const BrokenTradeMessage &message)
+    {
+        return (trade_book.erase(message.match_number) > 0) ? OrderBookResult::OK : OrderBookResult::TRADE_NOT_FOUND;
+    }
+
+    const ExecutedOrder *find_trade(uint64_t match_number) const
+    {
+        auto it = trade_book.find(match_number);
+        return (it == trade_book.end()) ? nullptr : &it->second;
+    }
+
+    // Handle of a live order, or NO_ORDER. Handles stay valid until the order is removed.
+    uint32_t find_order(uint64_t order_reference_number) const
+    {
+        size_t slot = order_index.find(order_reference_number);
+        return (slot == OrderIndex::NOT_FOUND) ? NO_ORDER : order_index.handle_at(slot);
+    }
+
+    const OrderRecord &get_order(uint32_t handle) const
+    {
+        return orders[handle];
+    }
+
+    size_t live_orders() const
+    {
+        return order_index.size();
+    }
+
+    // Copies up to max_levels of the best bid levels, best first, and returns how many were copied.
+    uint32_t get_bid_depth(uint16_t stock_locate, DepthLevel *depth, uint32_t max_levels) const
+    {
+        return (stock_locate < stock_books.size()) ? copy_depth(stock_books[stock_locate].bids, depth, max_levels) : 0;
+    }
+
+    uint32_t get_ask_depth(uint16_t stock_locate, DepthLevel *depth, uint32_t max_levels) const
+    {
+        return (stock_locate < stock_books.size()) ? copy_depth(stock_books[stock_locate].asks, depth, max_levels) : 0;
+    }
+
+    // Top SNAPSHOT_DEPTH levels and trading state of the stock, as the book publishers share them.
+    BookSnapshot get_snapshot(uint16_t stock_locate, uint64_t timestamp) const
+    {
+        BookSnapshot snapshot = {};
+        snapshot.timestamp = timestamp;
+        snapshot.bid_levels = get_bid_depth(stock_locate, snapshot.bids, SNAPSHOT_DEPTH);
+        snapshot.ask_levels = get_ask_depth(stock_locate, snapshot.asks, SNAPSHOT_DEPTH);
+        snapshot.trading_state = symbol_state(stock_locate).trading_state;
+        snapshot.state_flags = symbol_state(stock_locate).flags;
+        return snapshot;
+    }
+
+    size_t stock_locate_count() const
+    {
+        return stock_books.size();
+    }
+
+    // Packs a level's stock_locate, side and price so that sorted keys group by stock, then side.
+    static uint64_t level_key(uint16_t stock_locate, char side, Price price)
+    {
+        return ((uint64_t)stock_locate << 40) | ((uint64_t)(side != 'B') << 32) | price.raw;
+    }
+
+    static void split_level_key(uint64_t key, uint16_t &stock_locate, char &side, Price &price)
+    {
+        stock_locate = (uint16_t)(key >> 40);
+        side = ((key >> 32) & 1) ? 'S' : 'B';
+        price = Price((uint32_t)key);
+    }
+
+    // While on, every change to a level's order count or volume is logged for take_level_changes.
+    void set_level_change_tracking(bool enabled)
+    {
+        track_level_changes = enabled;
+        changed_levels.clear();
+    }
+
+    // Moves the level keys logged since the last call into keys, which is cleared first.
+    // A level appears once per change, so callers coalesce.
+    void take_level_changes(vector<uint64_t> &keys)
+    {
+        keys.clear();
+        keys.swap(changed_levels);
+    }
+
+    // The level at price on the stock's side, or nullptr if no order rests there.
+    const PriceLevel *find_level(uint16_t stock_locate, char side, Price price) const
+    {
+        if (stock_locate >= stock_books.size())
+        {
+            return nullptr;
+        }
+        const PriceLadder &ladder = (side == 'B') ? stock_books[stock_locate].bids : stock_books[stock_locate].asks;
+        uint32_t handle = ladder.find(price);
+        return (handle == NO_LEVEL) ? nullptr : &levels[handle];
+    }
+
+    // Calls function(side, level) for every price level of the stock, bids then asks, best first.
+    template <typename Function>
+    void for_each_level(uint16_t stock_locate, Function function) const
+    {
+        if (stock_locate >= stock_books.size())
+        {
+            return;
+        }
+        stock_books[stock_locate].bids.for_each([&](Price, uint32_t handle)
+                                                {
+            if (levels[handle].order_count > 0)
             {
-                OrderBookByStockEntry matching_entry = {
-                    .side = entry.side,
-                    .order_reference_number = key,
-                    .price = entry.price,
-                    .volume = entry.volume};
+                function('B', levels[handle]);
+            }
+            return true; });
+        stock_books[stock_locate].asks.for_each([&](Price, uint32_t handle)
+                                                {
+            if (levels[handle].order_count > 0)
+            {
+                function('S', levels[handle]);
+            }
+            return true; });
+    }
 
-                entries.push_back(matching_entry);
+    // Walks the queues of up to max_levels levels on one side of a stock, from the
+    // first level at or behind next_price in book order, and counts broken
+    // invariants: queue links, level counts and volumes, and orders that are empty
+    // or carry a price, side or stock different from their level. next_price is
+    // moved to the first level not checked, so a sweep can resume there later
+    // (start from Price::max() for bids and Price::min() for asks).
+    LevelCheck check_levels(uint16_t stock_locate, char side, Price &next_price, uint32_t max_levels) const
+    {
+        if (stock_locate >= stock_books.size())
+        {
+            return {.levels = 0, .errors = 0, .done = true};
+        }
+        const StockBook &book = stock_books[stock_locate];
+        return (side == 'B') ? check_side(book.bids, stock_locate, ORDER_FLAG_BUY, next_price, max_levels)
+                             : check_side(book.asks, stock_locate, 0, next_price, max_levels);
+    }
+
+    // Places a simulated order. The part marketable against the real book fills at
+    // once at the real levels' prices, without taking their volume out of the book;
+    // the rest joins the back of the queue at its price. Real executions then fill
+    // it (see fill_synthetic_ahead). Fills are collected with take_synthetic_fills.
+    // Returns the handle of the resting order, or NO_ORDER if it filled completely
+    // on entry; its fills then carry NO_ORDER too. A handle is recycled as soon as
+    // the order has no shares left.
+    uint32_t add_synthetic_order(uint16_t stock_locate, char side, Price price, uint32_t shares)
+    {
+        bool buy = side == 'B';
+        size_t first_fill = synthetic_fills.size();
+        const PriceLadder &opposite = buy ? stock_book(stock_locate).asks : stock_book(stock_locate).bids;
+        opposite.for_each([&](Price level_price, uint32_t level_handle)
+                          {
+            if (shares == 0 || (buy ? level_price > price : level_price < price))
+            {
+                return false;
+            }
+            uint32_t taken = (uint32_t)std::min<uint64_t>(shares, levels[level_handle].volume);
+            if (taken > 0)
+            {
+                shares -= taken;
+                synthetic_fills.push_back({.handle = NO_ORDER, .shares = taken, .price = level_price, .remaining = shares, .liquidity = 'R'});
+            }
+            return true; });
+
+        if (shares == 0)
+        {
+            return NO_ORDER;
+        }
+
+        uint32_t handle = allocate_order();
+        for (size_t i = first_fill; i < synthetic_fills.size(); i++)
+        {
+            synthetic_fills[i].handle = handle;
+        }
+        OrderRecord &order = orders[handle];
+        order.price = price;
+        order.volume = shares;
+        order.stock_locate = stock_locate;
+        order.flags = (buy ? ORDER_FLAG_BUY : 0) | ORDER_FLAG_SYNTHETIC;
+        link_order(handle);
+        count_synthetic(order, 1);
+        return handle;
+    }
+
+    // Removes a resting synthetic order; handle must be one that has not filled completely.
+    void cancel_synthetic_order(uint32_t handle)
+    {
+        count_synthetic(orders[handle], -1);
+        unlink_order(handle);
+        release_order(handle);
+    }
+
+    void take_synthetic_fills(vector<SyntheticFill> &fills)
+    {
+        fills.clear();
+        fills.swap(synthetic_fills);
+    }
+
+    const SymbolState &symbol_state(uint16_t stock_locate) const
+    {
+        static const SymbolState UNKNOWN = {};
+        return (stock_locate < symbol_states.size()) ? symbol_states[stock_locate] : UNKNOWN;
+    }
+
+    // Applies a trading action and returns the flags the stock had before it.
+    uint8_t set_trading_state(uint16_t stock_locate, char trading_state)
+    {
+        SymbolState &state = mutable_symbol_state(stock_locate);
+        uint8_t previous = state.flags;
+        uint8_t interrupted = previous & (SYMBOL_HALTED | SYMBOL_QUOTATION_ONLY);
+        uint8_t kept = previous & SYMBOL_SHORT_SALE_RESTRICTED;
+        state.trading_state = trading_state;
+
+        switch (trading_state)
+        {
+        case 'H':
+        case 'P':
+            state.flags = kept | SYMBOL_HALTED;
+            break;
+        case 'Q':
+            state.flags = kept | SYMBOL_QUOTATION_ONLY | SYMBOL_REOPENING;
+            break;
+        case 'T':
+            state.flags = kept | ((interrupted || (previous & SYMBOL_REOPENING)) ? SYMBOL_REOPENING : 0);
+            break;
+        default:
+            state.flags = previous;
+            break;
+        }
+        return previous;
+    }
+
+    void set_reg_sho_action(uint16_t stock_locate, char reg_sho_action)
+    {
+        SymbolState &state = mutable_symbol_state(stock_locate);
+        state.reg_sho_action = reg_sho_action;
+        bool restricted = reg_sho_action == '1' || reg_sho_action == '2';
+        state.flags = (state.flags & ~SYMBOL_SHORT_SALE_RESTRICTED) | (restricted ? SYMBOL_SHORT_SALE_RESTRICTED : 0);
+    }
+
+    // Ends the re-opening once its cross or first trade printed. Returns false if the stock was not re-opening.
+    bool end_reopening(uint16_t stock_locate)
+    {
+        if (!(symbol_state(stock_locate).flags & SYMBOL_REOPENING) || (symbol_state(stock_locate).flags & (SYMBOL_HALTED | SYMBOL_QUOTATION_ONLY)))
+        {
+            return false;
+        }
+        symbol_states[stock_locate].flags &= ~SYMBOL_REOPENING;
+        return true;
+    }
+
+    bool is_crossed(uint16_t stock_locate) const
+    {
+        DepthLevel bid;
+        DepthLevel ask;
+        return get_bid_depth(stock_locate, &bid, 1) > 0 && get_ask_depth(stock_locate, &ask, 1) > 0 && bid.price > ask.price;
+    }
+
+    // Where a live order stands in the FIFO queue at its price. Walks the orders
+    // ahead of it, so the cost is proportional to the queue position.
+    bool get_queue_position(uint64_t order_reference_number, QueuePosition &position) const
+    {
+        uint32_t handle = find_order(order_reference_number);
+        if (handle == NO_ORDER)
+        {
+            return false;
+        }
+
+        const PriceLevel &level = levels[orders[handle].level];
+        position = {
+            .orders_ahead = 0,
+            .shares_ahead = 0,
+            .level_order_count = level.order_count,
+            .level_volume = level.volume};
+
+        for (uint32_t ahead = orders[handle].prev; ahead != NO_ORDER; ahead = orders[ahead].prev)
+        {
+            if (!(orders[ahead].flags & ORDER_FLAG_SYNTHETIC))
+            {
+                position.orders_ahead++;
+                position.shares_ahead += orders[ahead].volume;
             }
         }
+        return true;
+    }
+
+    void get_orders_by_stock_locate(uint16_t stock_locate, vector<OrderBookByStockEntry> &entries)
+    {
+        order_index.for_each([&](uint64_t order_reference_number, uint32_t handle)
+                             {
+            const OrderRecord &order = orders[handle];
+            if (order.stock_locate == stock_locate)
+            {
+                OrderBookByStockEntry matching_entry = {
+                    .side = order_side(order),
+                    .order_reference_number = order_reference_number,
+                    .price = order.price,
+                    .volume = order.volume,
+                    .short_sale_restricted = (order.flags & ORDER_FLAG_SHORT_SALE_RESTRICTED) != 0};
+
+                entries.push_back(matching_entry);
+            } });
     }
 
     void print_orders_by_stock_locate(uint16_t stock_locate)
@@ -211,9 +947,9 @@ public:
 
     void print_executions_by_stock_locate(uint16_t stock_locate)
     {
-        for (const auto [key, entry] : trade_book)
+        for (const auto &[key, entry] : trade_book)
         {
-            if (entry.stock_locate == stock_locate) 
+            if (entry.stock_locate == stock_locate)
             {
                 std::cout << std::dec << entry.price << std::endl;
             }
@@ -224,13 +960,41 @@ public:
     {
         std::cout << "Order Reference Number,Side,Stock Locate,Price,Volume" << std::endl;
 
-        for (const auto &[order_ref_num, entry] : order_book)
+        order_index.for_each([&](uint64_t order_reference_number, uint32_t handle)
+                             {
+            const OrderRecord &order = orders[handle];
+            std::cout << order_reference_number << ","
+                      << order_side(order) << ","
+                      << order.stock_locate << ","
+                      << order.price << ","
+                      << order.volume << std::endl; });
+    }
+
+    // Bytes held by the order storage, so the per-order cost can be tracked as the layout changes.
+    void print_memory_report(std::ostream &os = std::cout) const
+    {
+        size_t level_count = 0;
+        size_t ladder_bytes = 0;
+        for (const StockBook &book : stock_books)
         {
-            std::cout << order_ref_num << ","
-                      << entry.side << ","
-                      << entry.stock_locate << ","
-                      << entry.price << ","
-                      << entry.volume << std::endl;
+            level_count += book.bids.size() + book.asks.size();
+            ladder_bytes += book.bids.memory_bytes() + book.asks.memory_bytes();
+        }
+
+        size_t record_bytes = orders.capacity() * sizeof(OrderRecord);
+        size_t index_bytes = order_index.memory_bytes();
+        size_t level_bytes = levels.capacity() * sizeof(PriceLevel) + stock_books.capacity() * sizeof(StockBook) + ladder_bytes;
+        size_t trade_bytes = trade_book.size() * (sizeof(pair<const uint64_t, ExecutedOrder>) + sizeof(void *)) + trade_book.bucket_count() * sizeof(void *);
+        size_t live = live_orders();
+
+        os << "Live orders: " << std::dec << live << " (record capacity " << orders.capacity() << ")" << std::endl;
+        os << "Order records: " << record_bytes << " bytes" << std::endl;
+        os << "Order index: " << index_bytes << " bytes" << std::endl;
+        os << "Price levels: " << level_count << " levels, " << level_bytes << " bytes" << std::endl;
+        os << "Trade book: " << trade_book.size() << " trades, " << trade_bytes << " bytes" << std::endl;
+        if (live > 0)
+        {
+            os << "Bytes per live order: " << (record_bytes + index_bytes + level_bytes) / live << std::endl;
         }
     }
 };
@@ -0,0 +1,149 @@
+#ifndef ORDER_INDEX_H
+#define ORDER_INDEX_H
+
+#include <cstdint>
+#include <vector>
+#include "memory_policy.h"
+using namespace std;
+
+constexpr uint32_t NO_ORDER = UINT32_MAX;
+
+// Open-addressing map from order reference number to a 32-bit order handle.
+// Slots are 16 bytes and stored inline, so a lookup is usually a single cache
+// miss instead of the bucket + node chase of unordered_map. Lookups return the
+// slot so that callers can read, update and erase with one probe.
+class OrderIndex
+{
+public:
+    static constexpr size_t NOT_FOUND = SIZE_MAX;
+
+    explicit OrderIndex(size_t initial_capacity = 1 << 16)
+    {
+        size_t capacity = 16;
+        while (capacity < initial_capacity)
+        {
+            capacity <<= 1;
+        }
+        resize(capacity);
+    }
+
+    size_t find(uint64_t order_reference_number) const
+    {
+        for (size_t slot = home(order_reference_number);; slot = (slot + 1) & mask)
+        {
+            if (slots[slot].handle == NO_ORDER)
+            {
+                return NOT_FOUND;
+            }
+            if (slots[slot].order_reference_number == order_reference_number)
+            {
+                return slot;
+            }
+        }
+    }
+
+    uint32_t handle_at(size_t slot) const
+    {
+        return slots[slot].handle;
+    }
+
+    // Returns false, leaving the index unchanged, if the reference is already present.
+    bool insert(uint64_t order_reference_number, uint32_t handle)
+    {
+        if ((count + 1) * 10 > slots.size() * 7)
+        {
+            resize(slots.size() * 2);
+        }
+
+        size_t slot = home(order_reference_number);
+        for (; slots[slot].handle != NO_ORDER; slot = (slot + 1) & mask)
+        {
+            if (slots[slot].order_reference_number == order_reference_number)
+            {
+                return false;
+            }
+        }
+
+        slots[slot] = {order_reference_number, handle};
+        count++;
+        return true;
+    }
+
+    // Backward-shift deletion: entries after the hole that may live there are
+    // moved up, so no tombstones are left behind to lengthen later probes.
+    void erase_at(size_t slot)
+    {
+        size_t hole = slot;
+        for (size_t next = (hole + 1) & mask; slots[next].handle != NO_ORDER; next = (next + 1) & mask)
+        {
+            size_t next_home = home(slots[next].order_reference_number);
+            if (((next - next_home) & mask) >= ((next - hole) & mask))
+            {
+                slots[hole] = slots[next];
+                hole = next;
+            }
+        }
+        slots[hole].handle = NO_ORDER;
+        count--;
+    }
+
+    template <typename Function>
+    void for_each(Function function) const
+    {
+        for (const Slot &slot : slots)
+        {
+            if (slot.handle != NO_ORDER)
+            {
+                function(slot.order_reference_number, slot.handle);
+            }
+        }
+    }
+
+    size_t size() const
+    {
+        return count;
+    }
+
+    size_t memory_bytes() const
+    {
+        return slots.capacity() * sizeof(Slot);
+    }
+
+private:
+    struct Slot
+    {
+        uint64_t order_reference_number;
+        uint32_t handle;
+    };
+
+    vector<Slot, PolicyAllocator<Slot>> slots;
+    size_t mask = 0;
+    unsigned shift = 0;
+    size_t count = 0;
+
+    // Reference numbers are handed out close to sequentially, so they are
+    // scrambled with a Fibonacci hash before taking the top bits.
+    size_t home(uint64_t order_reference_number) const
+    {
+        return (order_reference_number * 0x9E3779B97F4A7C15ull) >> shift;
+    }
+
+    void resize(size_t capacity)
+    {
+        vector<Slot, PolicyAllocator<Slot>> old_slots(capacity, Slot{0, NO_ORDER});
+        old_slots.swap(slots);
+        mask = capacity - 1;
+        shift = 64 - __builtin_ctzll(capacity);
+        count = 0;
+
+        for (const Slot &slot : old_slots)
+        {
+            if (slot.handle != NO_ORDER)
+            {
+                insert(slot.order_reference_number, slot.handle);
+            }
+        }
+    }
+};
+
+#endif // ORDER_INDEX_H
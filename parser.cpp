@@ -1,101 +1,754 @@
-#include <iostream>
-#include <fstream>
-#include <cstring>
-#include <byteswap.h>
-#include <signal.h>
-#include <stdlib.h>
-#include <stdio.h>
-#include <unistd.h>
-#include "helper.h"
-#include "instrument_table.h"
-#include "market_participants.h"
-#include "order_book.h"
-
-string ITCH_FEED = "12302019.NASDAQ_ITCH50";
-
-int main(int argc, char *argv[])
-{
-    std::ifstream file(ITCH_FEED, std::ios::binary);
-    InstrumentTable i_table = InstrumentTable();
-    MarketParticipantTable mp_table = MarketParticipantTable();
-    OrderBook order_book = OrderBook();
-    uint64_t i = 0;
-
-    while (true)
-    {
-        i++;
-        uint16_t length = read_length(&file);
-        MessageType message_type = read_message_type(&file);
-
-        if (message_type == MessageType::SYSTEM_EVENT_MESSAGE)
-        {
-            SystemEventMessage message = read_system_event_message(&file, length - 1);
-        }
-        else if (message_type == MessageType::STOCK_DIRECTORY_MESSAGE)
-        {
-            StockDirectoryMessage message = read_stock_directory_message(&file, length - 1);
-            i_table.add_to_instrument_table(message);
-        }
-        else if (message_type == MessageType::STOCK_TRADING_ACTION_MESSAGE)
-        {
-            StockTradingActionMessage message = read_stock_trading_action_message(&file, length - 1);
-            i_table.add_stock_trading_action_message(message);
-        }
-        else if (message_type == MessageType::REG_SHO_RESTRICTION)
-        {
-            RegSHORestriction message = read_reg_sho_restriction(&file, length - 1);
-            i_table.add_reg_sho_restriction(message);
-        }
-        else if (message_type == MessageType::MARKET_PARTICIPANT_POSITION)
-        {
-            MarketParticipantPosition message = read_market_participant_position(&file, length - 1);
-            mp_table.add_market_participant_position(message);
-        }
-        else if (message_type == MessageType::ADD_ORDER_MESSAGE)
-        {
-            AddOrderMessage message = read_add_order_message(&file, length - 1);
-            order_book.add_order(message);
-        }
-        else if (message_type == MessageType::DELETE_CANCEL_MESSAGE)
-        {
-            DeleteCancelMessage message = read_delete_cancel_message(&file, length - 1);
-            order_book.delete_cancel_order(message);
-        }
-        else if (message_type == MessageType::REPLACE_MESSAGE)
-        {
-            ReplaceOrderMessage message = read_replace_order_message(&file, length - 1);
-            order_book.relpace_order(message);
-        }
-        else if (message_type == MessageType::ORDER_EXECUTED_MESSAGE)
-        {
-            OrderExecutedMessage message = read_order_executed_message(&file, length - 1);
-            order_book.execute_order(message);
-        }
-        else if (message_type == MessageType::ORDER_EXECUTED_PRICE_MESSAGE)
-        {
-            OrderExecutedPriceMessage message = read_order_executed_price_message(&file, length - 1);
-            order_book.execute_order_price(message);
-        }
-        else if (message_type == MessageType::TRADE_CROSS_MESSAGE)
-        {
-            TradeCrossMessage message = read_trade_cross_message(&file, length - 1);
-            order_book.execute_cross_trade(message);
-        }
-        else if (message_type == MessageType::TRADE_NON_CROSS_MESSAGE)
-        {
-            TradeNonCrossMessage message = read_trade_non_cross_message(&file, length - 1);
-            order_book.execute_non_cross_trade(message);
-        }
-        else if (message_type == MessageType::MWCB_DECLINE_MESSAGE || message_type == MessageType::IPO_QUOTING_PERIOD || message_type == MessageType::NOII_MESSAGE || message_type == MessageType::LULD_AUCTION_COLLAR)
-        {
-            dummy_read(&file, length - 1);
-        }
-        else
-        {
-            std::cout << "Parsed: " << std::dec << i << " messages" << std::endl;
-            return 0;
-        }
-    }
-
-    return 0;
-}
\ No newline at end of file
+#include <iostream>
+#include <fstream>
+#include <atomic>
+#include <cstring>
+#include <chrono>
+#include <memory>
+#include <sched.h>
+#include <signal.h>
+#include <sstream>
+#include <stdlib.h>
+#include <stdio.h>
+#include <thread>
+#include <unistd.h>
+#include <unordered_set>
+#include "helper.h"
+#include "batch_replay.h"
+#include "replay.h"
+
+string ITCH_FEED = "12302019.NASDAQ_ITCH50";
+
+// What is printed once the replay stops. The book outputs cover the symbols
+// given with -s, or every stock in the stock directory when there are none.
+enum Output : uint32_t
+{
+    OUTPUT_COUNTERS = 1 << 0,
+    OUTPUT_VALIDATION = 1 << 1,
+    OUTPUT_MEMORY = 1 << 2,
+    OUTPUT_RATES = 1 << 3,
+    OUTPUT_BOOK = 1 << 4,
+    OUTPUT_ORDERS = 1 << 5,
+    OUTPUT_EXECUTIONS = 1 << 6,
+    OUTPUT_BBO = 1 << 7
+};
+
+constexpr uint32_t DEFAULT_OUTPUTS = OUTPUT_COUNTERS | OUTPUT_VALIDATION | OUTPUT_MEMORY | OUTPUT_RATES;
+constexpr uint32_t BOOK_OUTPUTS = OUTPUT_BOOK | OUTPUT_ORDERS | OUTPUT_EXECUTIONS;
+
+void print_usage(const char *program)
+{
+    std::cerr << "Usage: " << program << " [-D] [-H] [-G] [-c cpu] [-S statistics_prefix] [-L lifecycle_file] [-M delta_file] [-W microseconds] [-P segment] [-T] [-I seconds] [-R cache] [-C cache] [-X orders_file] [-F fills_file] [-l latencies] [-k checkpoints] [-f start] [-t end] [-n messages]"
+              << " [-s SYM1,SYM2,...] [-o output,...] [-j threads] [capture...]" << std::endl;
+    std::cerr << "  -D  read the capture with direct I/O and io_uring read-ahead" << std::endl;
+    std::cerr << "  -H  back the book and feed buffers with huge pages" << std::endl;
+    std::cerr << "  -G  try 1 GB pages before 2 MB ones (implies -H)" << std::endl;
+    std::cerr << "  -c  pin the replay to cpu and bind its memory to that cpu's NUMA node" << std::endl;
+    std::cerr << "  -S  write per-stock activity statistics to <prefix>.json and <prefix>.bin" << std::endl;
+    std::cerr << "  -L  follow every order from add to fill or cancel and write one record per order chain to lifecycle_file" << std::endl;
+    std::cerr << "  -M  write the book as coalesced market-by-price deltas to delta_file" << std::endl;
+    std::cerr << "  -W  coalesce the deltas of each level over this many microseconds of exchange time (default 0: per message);" << std::endl;
+    std::cerr << "      the stream only gets smaller than the feed once levels change more than once per window" << std::endl;
+    std::cerr << "  -P  publish top of book and last trade to this POSIX shared-memory segment for other processes (see shm_book_reader);" << std::endl;
+    std::cerr << "      the segment is left in place when the replay stops" << std::endl;
+    std::cerr << "  -T  publish top of book through per-stock seqlocks and read it back on a consumer thread" << std::endl;
+    std::cerr << "  -I  print the messages replayed and the resting orders every this many seconds of exchange time" << std::endl;
+    std::cerr << "  -R  preload symbols and MPIDs from a reference cache; the capture's own messages are checked against it" << std::endl;
+    std::cerr << "  -C  write the reference data to a cache once the replay stops" << std::endl;
+    std::cerr << "  -X  simulate the orders in orders_file (lines of time,symbol,B|S,price,shares[,cancel time]) against the book" << std::endl;
+    std::cerr << "  -F  write the simulated fills to fills_file" << std::endl;
+    std::cerr << "  -l  simulated latencies in microseconds: order entry,cancel,fill report[,jitter] (default 0,0,0)" << std::endl;
+    std::cerr << "  -k  message counts at which validation rebuilds the book from the capture and compares it, e.g. 1000000,5000000" << std::endl;
+    std::cerr << "      (default none: each rebuild reads the capture again, so only the sampled checks run)" << std::endl;
+    std::cerr << "  -f  exchange time HH:MM[:SS[.fraction]] from which statistics are recorded; earlier messages only build the book" << std::endl;
+    std::cerr << "  -t  stop at the first message after this exchange time" << std::endl;
+    std::cerr << "  -n  stop after this many messages" << std::endl;
+    std::cerr << "  -s  replay only these symbols" << std::endl;
+    std::cerr << "  -o  what to print when the replay stops: counters, validation, memory, rates, book, orders, executions, bbo" << std::endl;
+    std::cerr << "      (default counters,validation,memory,rates)" << std::endl;
+    std::cerr << "  -j  replay several captures on this many threads" << std::endl;
+    std::cerr << "The capture defaults to " << ITCH_FEED << " in the working directory. Captures whose name contains BX or PSX" << std::endl;
+    std::cerr << "are replayed as those venues; bbo prints the best bid and offer across the venues of all captures." << std::endl;
+}
+
+bool parse_outputs(const string &text, uint32_t &outputs)
+{
+    static const pair<const char *, Output> names[] = {
+        {"counters", OUTPUT_COUNTERS},
+        {"validation", OUTPUT_VALIDATION},
+        {"memory", OUTPUT_MEMORY},
+        {"rates", OUTPUT_RATES},
+        {"book", OUTPUT_BOOK},
+        {"orders", OUTPUT_ORDERS},
+        {"executions", OUTPUT_EXECUTIONS},
+        {"bbo", OUTPUT_BBO}};
+
+    outputs = 0;
+    std::stringstream list(text);
+    string name;
+    while (std::getline(list, name, ','))
+    {
+        bool known = false;
+        for (const auto &[output_name, output] : names)
+        {
+            if (name == output_name)
+            {
+                outputs |= output;
+                known = true;
+            }
+        }
+        if (!known)
+        {
+            std::cerr << "Unknown output: " << name << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Latencies given as entry,cancel,report[,jitter] microseconds.
+bool parse_latency_model(const string &text, LatencyModel &latency)
+{
+    uint64_t *fields[] = {&latency.order_entry, &latency.cancel, &latency.fill_report, &latency.jitter};
+    std::stringstream list(text);
+    string value;
+    size_t count = 0;
+    while (std::getline(list, value, ','))
+    {
+        uint64_t microseconds;
+        if (count == 4 || !parse_unsigned(value, UINT64_MAX / 1000, microseconds))
+        {
+            return false;
+        }
+        *fields[count++] = microseconds * 1000;
+    }
+    return count >= 3;
+}
+
+// Checkpoints given as a comma-separated list of message counts, or "none".
+bool parse_checkpoints(const string &text, vector<uint64_t> &checkpoints)
+{
+    checkpoints.clear();
+    if (text == "none")
+    {
+        return true;
+    }
+    std::stringstream list(text);
+    string value;
+    while (std::getline(list, value, ','))
+    {
+        uint64_t frames;
+        if (!parse_unsigned(value, UINT64_MAX, frames) || frames == 0)
+        {
+            return false;
+        }
+        checkpoints.push_back(frames);
+    }
+    return !checkpoints.empty();
+}
+
+// What the -T consumer thread saw of the BookPublisher.
+struct TopOfBookConsumerReport
+{
+    uint64_t reads;
+    // Publishes overwritten before the consumer got to them; a seqlock only keeps the latest.
+    uint64_t conflated;
+    // Copies whose timestamp went back for the stock.
+    uint64_t out_of_order;
+    // Copies whose levels were empty or not best first.
+    uint64_t malformed;
+    // Stocks whose last publish the consumer never read.
+    uint64_t missed_last;
+};
+
+// Polls the version of every stock and reads the ones that moved, until stop is
+// set; one more pass after that picks up the last publishes.
+void consume_top_of_book_updates(const BookPublisher &publisher, const std::atomic<bool> &stop, TopOfBookConsumerReport &report)
+{
+    size_t stock_locates = publisher.stock_locate_count();
+    vector<uint64_t> versions(stock_locates, 0);
+    vector<uint64_t> timestamps(stock_locates, 0);
+    bool last_pass = false;
+    while (!last_pass)
+    {
+        last_pass = stop.load(std::memory_order_acquire);
+        for (size_t stock_locate = 0; stock_locate < stock_locates; stock_locate++)
+        {
+            uint64_t version = publisher.version((uint16_t)stock_locate);
+            if (version == versions[stock_locate] || (version & 1))
+            {
+                continue;
+            }
+            // The copy is of this version only if the version did not move around it;
+            // otherwise it is read again on the next pass.
+            BookSnapshot snapshot;
+            if (!publisher.try_read((uint16_t)stock_locate, snapshot) || publisher.version((uint16_t)stock_locate) != version)
+            {
+                last_pass = false;
+                continue;
+            }
+            report.reads++;
+            report.conflated += (version - versions[stock_locate]) / 2 - 1;
+            report.out_of_order += (snapshot.timestamp < timestamps[stock_locate]) ? 1 : 0;
+            report.malformed += well_formed(snapshot) ? 0 : 1;
+            versions[stock_locate] = version;
+            timestamps[stock_locate] = snapshot.timestamp;
+        }
+    }
+    for (size_t stock_locate = 0; stock_locate < stock_locates; stock_locate++)
+    {
+        report.missed_last += (publisher.version((uint16_t)stock_locate) != versions[stock_locate]) ? 1 : 0;
+    }
+}
+
+// Stock locates whose book is printed: the requested symbols, or every stock in the directory.
+vector<uint16_t> selected_stock_locates(Replay &replay, const vector<string> &symbols)
+{
+    unordered_set<string> padded_symbols;
+    for (const string &symbol : symbols)
+    {
+        string padded = symbol.substr(0, 8);
+        padded.resize(8, ' ');
+        padded_symbols.insert(padded);
+    }
+
+    vector<uint16_t> stock_locates;
+    for (size_t stock_locate = 1; stock_locate <= UINT16_MAX; stock_locate++)
+    {
+        const InstrumentTableEntry *entry = replay.i_table.get_entry((uint16_t)stock_locate);
+        if (entry != nullptr && (padded_symbols.empty() || padded_symbols.count(entry->stock) > 0))
+        {
+            stock_locates.push_back((uint16_t)stock_locate);
+        }
+    }
+    return stock_locates;
+}
+
+void print_reference_cache_check(const InstrumentTable &i_table)
+{
+    const ReferenceCacheCheck &check = i_table.reference_cache_check();
+    uint64_t unconfirmed = 0;
+    i_table.for_each_entry([&](uint16_t, const InstrumentTableEntry &entry)
+                           { unconfirmed += entry.cached; });
+    std::cout << "Reference cache check: " << check.confirmed << " confirmed | " << check.changed << " changed | "
+              << check.added << " added | " << unconfirmed << " not seen" << std::endl;
+}
+
+// Consolidated best bid and offer of the requested symbols, or of every symbol seen on any venue.
+void print_consolidated_bbo(ConsolidatedBbo &bbo, const vector<string> &symbols)
+{
+    unordered_set<string> padded_symbols;
+    for (const string &symbol : symbols)
+    {
+        string padded = symbol.substr(0, 8);
+        padded.resize(8, ' ');
+        padded_symbols.insert(padded);
+    }
+
+    auto venue_list = [](uint8_t venues)
+    {
+        string list;
+        for (size_t venue = 0; venue < VENUE_COUNT; venue++)
+        {
+            if (venues & (1 << venue))
+            {
+                if (!list.empty())
+                {
+                    list += '|';
+                }
+                list += VENUE_NAMES[venue];
+            }
+        }
+        return list;
+    };
+
+    std::cout << "Symbol,Bid,Bid Volume,Bid Venues,Ask,Ask Volume,Ask Venues" << std::endl;
+    for (uint32_t id = 0; id < bbo.symbol_count(); id++)
+    {
+        string stock = bbo.symbol(id);
+        if (!padded_symbols.empty() && padded_symbols.count(stock) == 0)
+        {
+            continue;
+        }
+        ConsolidatedQuote quote = bbo.read(id);
+        std::cout << stock.substr(0, stock.find_last_not_of(' ') + 1) << ","
+                  << quote.bid_price << "," << quote.bid_volume << "," << venue_list(quote.bid_venues) << ","
+                  << quote.ask_price << "," << quote.ask_volume << "," << venue_list(quote.ask_venues) << std::endl;
+    }
+}
+
+void print_book_outputs(Replay &replay, const vector<string> &symbols, uint32_t outputs)
+{
+    vector<uint16_t> stock_locates = selected_stock_locates(replay, symbols);
+
+    if (outputs & OUTPUT_BOOK)
+    {
+        std::cout << "Book at " << format_timestamp(replay.event_clock.now()) << std::endl;
+        std::cout << "Symbol,Side,Price,Orders,Volume" << std::endl;
+        for (uint16_t stock_locate : stock_locates)
+        {
+            const string &stock = replay.i_table.get_entry(stock_locate)->stock;
+            string symbol = stock.substr(0, stock.find_last_not_of(' ') + 1);
+            replay.order_book.for_each_level(stock_locate, [&](char side, const PriceLevel &level)
+                                             { std::cout << symbol << "," << side << "," << level.price << ","
+                                                         << level.order_count << "," << level.volume << std::endl; });
+        }
+    }
+    // Same formats as book_visualizer.py and execution_visualizer.py read.
+    for (uint16_t stock_locate : stock_locates)
+    {
+        if (outputs & OUTPUT_ORDERS)
+        {
+            replay.order_book.print_orders_by_stock_locate(stock_locate);
+        }
+        if (outputs & OUTPUT_EXECUTIONS)
+        {
+            replay.order_book.print_executions_by_stock_locate(stock_locate);
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    MemoryPolicy memory_policy = {.huge_pages = false, .gigantic_pages = false, .numa_node = -1};
+    int cpu = -1;
+    string statistics_prefix;
+    string lifecycle_path;
+    string delta_path;
+    uint64_t coalesce_interval = 0;
+    string segment_name;
+    bool consume_top_of_book = false;
+    uint64_t progress_interval = 0;
+    string load_cache_path;
+    string write_cache_path;
+    string orders_path;
+    string fills_path;
+    LatencyModel latency = {};
+    vector<uint64_t> checkpoints;
+    ReadMode read_mode = ReadMode::BUFFERED;
+    ReplayWindow window;
+    vector<string> symbols;
+    uint32_t outputs = DEFAULT_OUTPUTS;
+    size_t threads = 1;
+
+    int option;
+    while ((option = getopt(argc, argv, "DHGc:S:L:M:W:P:TI:R:C:X:F:l:k:f:t:n:s:o:j:")) != -1)
+    {
+        switch (option)
+        {
+        case 'D':
+            read_mode = ReadMode::DIRECT;
+            break;
+        case 'G':
+            memory_policy.gigantic_pages = true;
+            memory_policy.huge_pages = true;
+            break;
+        case 'H':
+            memory_policy.huge_pages = true;
+            break;
+        case 'c':
+        {
+            uint64_t cpu_index;
+            if (!parse_unsigned(optarg, CPU_SETSIZE - 1, cpu_index))
+            {
+                print_usage(argv[0]);
+                return 1;
+            }
+            cpu = (int)cpu_index;
+            break;
+        }
+        case 'S':
+            statistics_prefix = optarg;
+            break;
+        case 'L':
+            lifecycle_path = optarg;
+            break;
+        case 'M':
+            delta_path = optarg;
+            break;
+        case 'W':
+            // Microseconds, held in nanoseconds.
+            if (!parse_unsigned(optarg, UINT64_MAX / 1000, coalesce_interval))
+            {
+                print_usage(argv[0]);
+                return 1;
+            }
+            coalesce_interval *= 1000;
+            break;
+        case 'P':
+            segment_name = optarg;
+            break;
+        case 'T':
+            consume_top_of_book = true;
+            break;
+        case 'I':
+            // Seconds, held in nanoseconds.
+            if (!parse_unsigned(optarg, SECONDS_PER_DAY, progress_interval) || progress_interval == 0)
+            {
+                print_usage(argv[0]);
+                return 1;
+            }
+            progress_interval *= NANOSECONDS_PER_SECOND;
+            break;
+        case 'R':
+            load_cache_path = optarg;
+            break;
+        case 'C':
+            write_cache_path = optarg;
+            break;
+        case 'X':
+            orders_path = optarg;
+            break;
+        case 'F':
+            fills_path = optarg;
+            break;
+        case 'l':
+            if (!parse_latency_model(optarg, latency))
+            {
+                print_usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'k':
+            if (!parse_checkpoints(optarg, checkpoints))
+            {
+                print_usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'f':
+        case 't':
+            if (!parse_time_of_day(optarg, (option == 'f') ? window.start_timestamp : window.end_timestamp))
+            {
+                std::cerr << "Invalid time: " << optarg << std::endl;
+                return 1;
+            }
+            break;
+        case 'n':
+            if (!parse_unsigned(optarg, UINT64_MAX, window.max_messages))
+            {
+                print_usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 's':
+        {
+            std::stringstream list(optarg);
+            string symbol;
+            while (std::getline(list, symbol, ','))
+            {
+                symbols.push_back(symbol);
+            }
+            break;
+        }
+        case 'o':
+            if (!parse_outputs(optarg, outputs))
+            {
+                return 1;
+            }
+            break;
+        case 'j':
+        {
+            uint64_t count;
+            if (!parse_unsigned(optarg, 4096, count))
+            {
+                print_usage(argv[0]);
+                return 1;
+            }
+            threads = std::max((size_t)1, (size_t)count);
+            break;
+        }
+        default:
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    vector<string> paths = expand_capture_paths(vector<string>(argv + optind, argv + argc));
+    if (paths.empty())
+    {
+        paths.push_back(ITCH_FEED);
+    }
+
+    // Several captures go through BatchReplay, which only keeps the counters of each.
+    if (paths.size() > 1)
+    {
+        if ((outputs & BOOK_OUTPUTS) != 0 || !statistics_prefix.empty() || !lifecycle_path.empty() || !delta_path.empty() || !segment_name.empty() || consume_top_of_book || progress_interval > 0 ||
+            !load_cache_path.empty() || !write_cache_path.empty() || !orders_path.empty() || cpu >= 0)
+        {
+            std::cerr << "Book outputs, -S, -L, -M, -P, -T, -I, -R, -C, -X and -c need a single capture" << std::endl;
+            return 1;
+        }
+        ConsolidatedBbo consolidated_bbo;
+        if (outputs & OUTPUT_BBO)
+        {
+            bool seen[VENUE_COUNT] = {};
+            for (const string &path : paths)
+            {
+                Venue venue = venue_from_path(path);
+                if (seen[(size_t)venue])
+                {
+                    std::cerr << "bbo needs one capture per venue; " << venue_name(venue) << " appears twice" << std::endl;
+                    return 1;
+                }
+                seen[(size_t)venue] = true;
+            }
+        }
+
+        set_memory_policy(memory_policy);
+        BatchReplayOptions options = {
+            .threads = threads,
+            .memory_budget = 16ull << 30,
+            .output_dir = "",
+            .symbols = symbols,
+            .read_mode = read_mode,
+            .window = window,
+            .consolidated_bbo = (outputs & OUTPUT_BBO) ? &consolidated_bbo : nullptr};
+        BatchReplay batch(options);
+        auto start = std::chrono::steady_clock::now();
+        vector<BatchReplayResult> results = batch.run(paths);
+        double wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        batch.print_throughput_report(results, wall_seconds);
+        if (outputs & OUTPUT_BBO)
+        {
+            print_consolidated_bbo(consolidated_bbo, symbols);
+        }
+        for (const BatchReplayResult &result : results)
+        {
+            if (!result.opened || result.counters.read_errors > 0)
+            {
+                return 1;
+            }
+        }
+        return 0;
+    }
+
+    // Pinning comes first so that the book is allocated from the replay thread's node.
+    if (cpu >= 0)
+    {
+        if (!pin_current_thread(cpu))
+        {
+            std::cerr << "Could not pin to cpu " << cpu << std::endl;
+            return 1;
+        }
+        memory_policy.numa_node = cpu_numa_node(cpu);
+    }
+    set_memory_policy(memory_policy);
+
+    Replay replay;
+    replay.read_mode = read_mode;
+    replay.window = window;
+    replay.venue = venue_from_path(paths[0]);
+    for (const string &symbol : symbols)
+    {
+        replay.symbol_filter.add_symbol(symbol);
+    }
+
+    if (!load_cache_path.empty())
+    {
+        auto start = std::chrono::steady_clock::now();
+        ReferenceCache cache;
+        if (!cache.open(load_cache_path))
+        {
+            std::cerr << "Could not load reference cache " << load_cache_path << std::endl;
+            return 1;
+        }
+        replay.load_reference_cache(cache);
+        double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "Reference cache: " << cache.instrument_count() << " instruments and " << cache.participant_count()
+                  << " participants loaded in " << milliseconds << " ms" << std::endl;
+    }
+
+    BookValidatorOptions validator_options = {
+        .sample_interval = 4096,
+        .levels_per_sample = 4,
+        .checkpoints = checkpoints,
+        .read_mode = read_mode};
+    BookValidator book_validator(paths[0], validator_options, replay.symbol_filter);
+    if (outputs & OUTPUT_VALIDATION)
+    {
+        replay.book_validator = &book_validator;
+    }
+
+    ActivityStatistics activity_statistics;
+    if (!statistics_prefix.empty())
+    {
+        replay.activity_statistics = &activity_statistics;
+    }
+
+    LifecycleTracker lifecycle_tracker;
+    if (!lifecycle_path.empty())
+    {
+        if (!lifecycle_tracker.open(lifecycle_path))
+        {
+            std::cerr << "Could not create " << lifecycle_path << std::endl;
+            return 1;
+        }
+        replay.lifecycle_tracker = &lifecycle_tracker;
+    }
+
+    DeltaPublisher delta_publisher(coalesce_interval);
+    if (!delta_path.empty())
+    {
+        if (!delta_publisher.open(delta_path))
+        {
+            std::cerr << "Could not create " << delta_path << std::endl;
+            return 1;
+        }
+        replay.delta_publisher = &delta_publisher;
+    }
+
+    ShmBookWriter shm_book_writer;
+    if (!segment_name.empty())
+    {
+        if (!shm_book_writer.create(segment_name))
+        {
+            std::cerr << "Could not create shared memory segment " << segment_name << std::endl;
+            return 1;
+        }
+        replay.shm_book_writer = &shm_book_writer;
+    }
+
+    ConsolidatedBbo consolidated_bbo;
+    if (outputs & OUTPUT_BBO)
+    {
+        replay.consolidated_bbo = &consolidated_bbo;
+    }
+
+    MatchingSimulator matching_simulator(latency);
+    if (!orders_path.empty())
+    {
+        if (!matching_simulator.load_orders(orders_path))
+        {
+            return 1;
+        }
+        replay.matching_simulator = &matching_simulator;
+    }
+    else if (!fills_path.empty())
+    {
+        std::cerr << "-F needs simulated orders (-X)" << std::endl;
+        return 1;
+    }
+
+    unique_ptr<BookPublisher> book_publisher;
+    std::atomic<bool> stop_consumer{false};
+    TopOfBookConsumerReport consumer_report = {};
+    std::thread consumer;
+    if (consume_top_of_book)
+    {
+        book_publisher = std::make_unique<BookPublisher>();
+        replay.book_publisher = book_publisher.get();
+        consumer = std::thread(consume_top_of_book_updates, std::cref(*book_publisher), std::cref(stop_consumer), std::ref(consumer_report));
+    }
+
+    // The tick fires before the message that crossed the boundary is applied, but after it was counted.
+    if (progress_interval > 0)
+    {
+        std::cout << "Time,Messages,Resting Orders" << std::endl;
+        replay.event_clock.add_interval(progress_interval, [&replay](uint64_t tick)
+                                        { std::cout << format_timestamp(tick) << "," << replay.counters.frames - 1 << ","
+                                                    << replay.order_book.live_orders() << std::endl; });
+    }
+
+    TlbCounters tlb_counters;
+    tlb_counters.start();
+    bool opened = replay.run(paths[0]);
+    tlb_counters.stop();
+    if (consumer.joinable())
+    {
+        stop_consumer.store(true, std::memory_order_release);
+        consumer.join();
+    }
+    if (!opened)
+    {
+        return 1;
+    }
+
+    if (outputs & OUTPUT_COUNTERS)
+    {
+        print_replay_counters(replay.counters);
+        if (replay.stopped_early)
+        {
+            std::cout << "Stopped early at " << format_timestamp(replay.event_clock.now()) << std::endl;
+        }
+        if (!load_cache_path.empty())
+        {
+            print_reference_cache_check(replay.i_table);
+        }
+    }
+    if (outputs & OUTPUT_VALIDATION)
+    {
+        book_validator.finish();
+        book_validator.print_report();
+    }
+    if (outputs & OUTPUT_MEMORY)
+    {
+        replay.order_book.print_memory_report();
+        print_memory_policy_stats();
+        tlb_counters.print_report(replay.counters.frames);
+    }
+    if (outputs & BOOK_OUTPUTS)
+    {
+        print_book_outputs(replay, symbols, outputs);
+    }
+    if (outputs & OUTPUT_BBO)
+    {
+        print_consolidated_bbo(consolidated_bbo, symbols);
+    }
+
+    if (replay.activity_statistics != nullptr)
+    {
+        activity_statistics.finish();
+        activity_statistics.print_summary();
+        if (!activity_statistics.write_json(statistics_prefix + ".json", replay.i_table) ||
+            !activity_statistics.write_binary(statistics_prefix + ".bin"))
+        {
+            std::cerr << "Could not write statistics to " << statistics_prefix << std::endl;
+            return 1;
+        }
+    }
+    if (replay.lifecycle_tracker != nullptr)
+    {
+        lifecycle_tracker.finish(replay.event_clock.now());
+        lifecycle_tracker.print_summary();
+    }
+    if (replay.delta_publisher != nullptr)
+    {
+        delta_publisher.finish(replay.order_book);
+        delta_publisher.print_summary(replay.counters.frames, replay.counters.bytes);
+    }
+    if (replay.book_publisher != nullptr)
+    {
+        std::cout << "Top of book consumer: " << consumer_report.reads << " reads | " << consumer_report.conflated << " conflated | "
+                  << consumer_report.out_of_order << " out of order | " << consumer_report.malformed << " malformed | "
+                  << consumer_report.missed_last << " last updates missed" << std::endl;
+        if (consumer_report.out_of_order > 0 || consumer_report.malformed > 0 || consumer_report.missed_last > 0)
+        {
+            std::cerr << "The top of book consumer read inconsistent updates" << std::endl;
+            return 1;
+        }
+    }
+    if (replay.matching_simulator != nullptr)
+    {
+        matching_simulator.print_summary();
+        if (!fills_path.empty() && !matching_simulator.write_fills(fills_path))
+        {
+            std::cerr << "Could not write simulated fills to " << fills_path << std::endl;
+            return 1;
+        }
+    }
+    if (!write_cache_path.empty() && !write_reference_cache(write_cache_path, replay.i_table, replay.mp_table))
+    {
+        std::cerr << "Could not write reference cache " << write_cache_path << std::endl;
+        return 1;
+    }
+    if (outputs & OUTPUT_RATES)
+    {
+        replay.event_clock.print_rate_profile();
+    }
+    if (replay.counters.read_errors > 0)
+    {
+        std::cerr << "The replay stopped on a read error at " << format_timestamp(replay.event_clock.now()) << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,52 @@
+#ifndef PRICE_H
+#define PRICE_H
+
+#include <compare>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+
+// ITCH Price(4) fields: an unsigned count of 1/10000 dollar. Kept as the raw
+// integer so that comparisons and level lookups stay integer operations; only
+// printing and to_double apply the scale.
+struct Price
+{
+    static constexpr uint32_t SCALE = 10000;
+    // Regulation NMS minimum increment for quotes of $1.00 and above.
+    static constexpr uint32_t PENNY = 100;
+
+    uint32_t raw;
+
+    constexpr Price() = default;
+    constexpr explicit Price(uint32_t raw) : raw(raw) {}
+
+    static constexpr Price min()
+    {
+        return Price(0);
+    }
+
+    static constexpr Price max()
+    {
+        return Price(UINT32_MAX);
+    }
+
+    constexpr double to_double() const
+    {
+        return (double)raw / SCALE;
+    }
+
+    constexpr auto operator<=>(const Price &) const = default;
+};
+
+static_assert(sizeof(Price) == 4, "Price must stay the size of the wire field");
+
+// Prints with the four implied decimals, e.g. 123.4500.
+inline std::ostream &operator<<(std::ostream &os, Price price)
+{
+    char fill = os.fill('0');
+    os << std::dec << price.raw / Price::SCALE << '.' << std::setw(4) << price.raw % Price::SCALE;
+    os.fill(fill);
+    return os;
+}
+
+#endif // PRICE_H
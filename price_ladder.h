@@ -0,0 +1,310 @@
+#ifndef PRICE_LADDER_H
+#define PRICE_LADDER_H
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <vector>
+#include "price.h"
+using namespace std;
+
+constexpr uint32_t NO_LEVEL = UINT32_MAX;
+
+// Price to level handle for one side of one stock. Levels on the tick grid
+// within DENSE_TICKS ticks of the window are kept in a plain array indexed by
+// tick, so adding, finding and removing a level there is array indexing. Prices
+// outside the window, or off the tick grid, fall back to a std::map. The window
+// is centred on the first price added, and moved to the best price once more
+// levels live outside it than inside.
+class PriceLadder
+{
+public:
+    static constexpr uint32_t DENSE_TICKS = 256;
+
+    // Bids are visited highest price first, asks lowest first.
+    explicit PriceLadder(bool bids) : bids(bids) {}
+
+    uint32_t find(Price price) const
+    {
+        size_t index;
+        if (dense_index(price, index))
+        {
+            return dense[index];
+        }
+        auto it = sparse.find(price.raw);
+        return (it == sparse.end()) ? NO_LEVEL : it->second;
+    }
+
+    // The price must not be in the ladder yet.
+    void insert(Price price, uint32_t handle)
+    {
+        size_t index;
+        if (dense_index(price, index))
+        {
+            set_dense(index, handle);
+            return;
+        }
+
+        // Moving the window costs a pass over every level, so once it holds
+        // levels it only moves after many misses have gone to the map.
+        if (dense_count == 0 || (sparse_inserts > DENSE_TICKS && sparse.size() > dense_count))
+        {
+            recentre(dense_count == 0 ? price : best());
+            if (dense_index(price, index))
+            {
+                set_dense(index, handle);
+                return;
+            }
+        }
+        sparse.emplace(price.raw, handle);
+        sparse_inserts++;
+    }
+
+    void erase(Price price)
+    {
+        size_t index;
+        if (dense_index(price, index))
+        {
+            clear_dense(index);
+        }
+        else
+        {
+            sparse.erase(price.raw);
+        }
+    }
+
+    size_t size() const
+    {
+        return dense_count + sparse.size();
+    }
+
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+    // Best price on this side; only valid when the ladder is not empty.
+    Price best() const
+    {
+        Price price = bids ? Price::min() : Price::max();
+        for_each_from(bids ? Price::max() : Price::min(), [&price](Price level_price, uint32_t)
+                      {
+            price = level_price;
+            return false; });
+        return price;
+    }
+
+    // Calls function(price, handle) for each level in book order, starting with
+    // the first level at or behind from, until it returns false.
+    template <typename Function>
+    void for_each_from(Price from, Function function) const
+    {
+        if (bids)
+        {
+            for_each_descending(from, function);
+        }
+        else
+        {
+            for_each_ascending(from, function);
+        }
+    }
+
+    template <typename Function>
+    void for_each(Function function) const
+    {
+        for_each_from(bids ? Price::max() : Price::min(), function);
+    }
+
+    size_t memory_bytes() const
+    {
+        // std::map nodes carry three pointers and a colour on top of the value.
+        return dense.capacity() * sizeof(uint32_t) + sizeof(occupied) + sparse.size() * (sizeof(pair<const uint32_t, uint32_t>) + 4 * sizeof(void *));
+    }
+
+private:
+    static constexpr size_t OCCUPIED_WORDS = DENSE_TICKS / 64;
+
+    bool bids;
+    // Price of dense[0] and the spacing between slots, both in raw price units.
+    uint32_t base = 0;
+    uint32_t tick = 1;
+    vector<uint32_t> dense;
+    uint64_t occupied[OCCUPIED_WORDS] = {};
+    size_t dense_count = 0;
+    map<uint32_t, uint32_t> sparse;
+    // Levels added to the map since the window last moved.
+    size_t sparse_inserts = 0;
+
+    bool dense_index(Price price, size_t &index) const
+    {
+        if (dense.empty() || price.raw < base)
+        {
+            return false;
+        }
+        uint32_t offset = price.raw - base;
+        index = offset / tick;
+        return index < DENSE_TICKS && offset % tick == 0;
+    }
+
+    Price dense_price(size_t index) const
+    {
+        return Price(base + (uint32_t)index * tick);
+    }
+
+    void set_dense(size_t index, uint32_t handle)
+    {
+        dense[index] = handle;
+        occupied[index / 64] |= 1ull << (index % 64);
+        dense_count++;
+    }
+
+    void clear_dense(size_t index)
+    {
+        dense[index] = NO_LEVEL;
+        occupied[index / 64] &= ~(1ull << (index % 64));
+        dense_count--;
+    }
+
+    // Moves the window so that it is centred on price, with the tick size that
+    // applies there, and redistributes the levels between array and map.
+    void recentre(Price price)
+    {
+        vector<pair<uint32_t, uint32_t>> all_levels(sparse.begin(), sparse.end());
+        for (size_t index = 0; index < dense.size(); index++)
+        {
+            if (dense[index] != NO_LEVEL)
+            {
+                all_levels.emplace_back(dense_price(index).raw, dense[index]);
+            }
+        }
+
+        tick = (price.raw >= Price::SCALE && price.raw % Price::PENNY == 0) ? Price::PENNY : 1;
+        uint32_t half_window = DENSE_TICKS / 2 * tick;
+        base = (price.raw > half_window) ? price.raw / tick * tick - half_window : price.raw % tick;
+        dense.assign(DENSE_TICKS, NO_LEVEL);
+        std::fill(std::begin(occupied), std::end(occupied), 0);
+        dense_count = 0;
+        sparse.clear();
+        sparse_inserts = 0;
+
+        for (const auto &[level_price, handle] : all_levels)
+        {
+            size_t index;
+            if (dense_index(Price(level_price), index))
+            {
+                set_dense(index, handle);
+            }
+            else
+            {
+                sparse.emplace(level_price, handle);
+            }
+        }
+    }
+
+    // Next occupied slot at or after index, or DENSE_TICKS.
+    size_t next_occupied(size_t index) const
+    {
+        while (index < DENSE_TICKS)
+        {
+            uint64_t bits = occupied[index / 64] >> (index % 64);
+            if (bits != 0)
+            {
+                return index + __builtin_ctzll(bits);
+            }
+            index = (index / 64 + 1) * 64;
+        }
+        return DENSE_TICKS;
+    }
+
+    // Previous occupied slot at or before index, or SIZE_MAX.
+    size_t previous_occupied(size_t index) const
+    {
+        while (index != SIZE_MAX)
+        {
+            uint64_t bits = occupied[index / 64] << (63 - index % 64);
+            if (bits != 0)
+            {
+                return index - __builtin_clzll(bits);
+            }
+            index = index / 64 * 64 - 1;
+        }
+        return SIZE_MAX;
+    }
+
+    // Both walks merge the array and the map, since off-grid prices can sit
+    // between the slots of the window.
+    template <typename Function>
+    void for_each_ascending(Price from, Function function) const
+    {
+        auto it = sparse.lower_bound(from.raw);
+        size_t index = DENSE_TICKS;
+        if (!dense.empty())
+        {
+            index = (from.raw <= base) ? 0 : std::min<size_t>(DENSE_TICKS, ((uint64_t)from.raw - base + tick - 1) / tick);
+            index = next_occupied(index);
+        }
+
+        while (index < DENSE_TICKS || it != sparse.end())
+        {
+            if (index < DENSE_TICKS && (it == sparse.end() || dense_price(index).raw < it->first))
+            {
+                if (!function(dense_price(index), dense[index]))
+                {
+                    return;
+                }
+                index = next_occupied(index + 1);
+            }
+            else
+            {
+                if (!function(Price(it->first), it->second))
+                {
+                    return;
+                }
+                ++it;
+            }
+        }
+    }
+
+    template <typename Function>
+    void for_each_descending(Price from, Function function) const
+    {
+        auto it = sparse.upper_bound(from.raw);
+        bool sparse_left = it != sparse.begin();
+        if (sparse_left)
+        {
+            --it;
+        }
+
+        size_t index = SIZE_MAX;
+        if (!dense.empty() && from.raw >= base)
+        {
+            index = previous_occupied(std::min<size_t>(DENSE_TICKS - 1, (from.raw - base) / tick));
+        }
+
+        while (index != SIZE_MAX || sparse_left)
+        {
+            if (index != SIZE_MAX && (!sparse_left || dense_price(index).raw > it->first))
+            {
+                if (!function(dense_price(index), dense[index]))
+                {
+                    return;
+                }
+                index = (index == 0) ? SIZE_MAX : previous_occupied(index - 1);
+            }
+            else
+            {
+                if (!function(Price(it->first), it->second))
+                {
+                    return;
+                }
+                sparse_left = it != sparse.begin();
+                if (sparse_left)
+                {
+                    --it;
+                }
+            }
+        }
+    }
+};
+
+#endif // PRICE_LADDER_H
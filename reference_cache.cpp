@@ -0,0 +1,153 @@
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+#include "reference_cache.h"
+
+static CachedInstrument cached_instrument(uint16_t stock_locate, const InstrumentTableEntry &entry)
+{
+    CachedInstrument instrument = {};
+    instrument.stock_locate = stock_locate;
+    memcpy(instrument.stock, entry.stock.data(), std::min(entry.stock.size(), sizeof(instrument.stock)));
+    instrument.market_category = entry.market_category;
+    instrument.financial_status_indicator = entry.financial_status_indicator;
+    instrument.round_lot_size = entry.round_lot_size;
+    instrument.etp_leverage_factor = entry.etp_leverage_factor;
+    instrument.round_lots_only = entry.round_lots_only;
+    instrument.issue_classification = entry.issue_classification;
+    memcpy(instrument.issue_sub_type, entry.issue_sub_type, sizeof(instrument.issue_sub_type));
+    instrument.authenticity = entry.authenticity;
+    instrument.short_sale_threshold = entry.short_sale_threshold;
+    instrument.ipo_flag = entry.ipo_flag;
+    instrument.luld_reference_price_tier = entry.luld_reference_price_tier;
+    instrument.etp_flag = entry.etp_flag;
+    instrument.inverse_indicator = entry.inverse_indicator;
+    instrument.trading_state = entry.trading_state;
+    memcpy(instrument.reason, entry.reason, sizeof(instrument.reason));
+    instrument.reg_sho_action = entry.reg_sho_action;
+    instrument.retail_interest_flag = entry.retail_interest_flag;
+    instrument.operational_halt_action = entry.operational_halt_action;
+    return instrument;
+}
+
+InstrumentTableEntry instrument_entry(const CachedInstrument &instrument)
+{
+    InstrumentTableEntry entry = {};
+    entry.stock = string(instrument.stock, sizeof(instrument.stock));
+    entry.market_category = instrument.market_category;
+    entry.financial_status_indicator = instrument.financial_status_indicator;
+    entry.round_lot_size = instrument.round_lot_size;
+    entry.round_lots_only = instrument.round_lots_only != 0;
+    entry.issue_classification = instrument.issue_classification;
+    memcpy(entry.issue_sub_type, instrument.issue_sub_type, sizeof(entry.issue_sub_type));
+    entry.authenticity = instrument.authenticity;
+    entry.short_sale_threshold = instrument.short_sale_threshold;
+    entry.ipo_flag = instrument.ipo_flag;
+    entry.luld_reference_price_tier = instrument.luld_reference_price_tier;
+    entry.etp_flag = instrument.etp_flag;
+    entry.etp_leverage_factor = instrument.etp_leverage_factor;
+    entry.inverse_indicator = instrument.inverse_indicator != 0;
+    entry.retail_interest_flag = instrument.retail_interest_flag;
+    entry.operational_halt_action = instrument.operational_halt_action;
+    return entry;
+}
+
+bool write_reference_cache(const string &path, const InstrumentTable &i_table, const MarketParticipantTable &mp_table)
+{
+    vector<CachedInstrument> instruments;
+    i_table.for_each_entry([&](uint16_t stock_locate, const InstrumentTableEntry &entry)
+                           { instruments.push_back(cached_instrument(stock_locate, entry)); });
+    std::sort(instruments.begin(), instruments.end(), [](const CachedInstrument &a, const CachedInstrument &b)
+              { return a.stock_locate < b.stock_locate; });
+
+    vector<CachedParticipant> participants;
+    mp_table.for_each_position([&](const string &mpid, const string &stock, const MarketParticipantFlags &flags)
+                               {
+        CachedParticipant participant = {};
+        memcpy(participant.mpid, mpid.data(), std::min(mpid.size(), sizeof(participant.mpid)));
+        memcpy(participant.stock, stock.data(), std::min(stock.size(), sizeof(participant.stock)));
+        participant.primary_market_maker = flags.primary_market_maker;
+        participant.market_maker_mode = flags.market_maker_mode;
+        participant.market_participant_state = flags.market_participant_state;
+        participants.push_back(participant); });
+    std::sort(participants.begin(), participants.end(), [](const CachedParticipant &a, const CachedParticipant &b)
+              {
+        int order = memcmp(a.stock, b.stock, sizeof(a.stock));
+        return (order != 0) ? order < 0 : memcmp(a.mpid, b.mpid, sizeof(a.mpid)) < 0; });
+
+    ReferenceCacheHeader header = {};
+    memcpy(header.magic, REFERENCE_CACHE_MAGIC, sizeof(header.magic));
+    header.version = REFERENCE_CACHE_VERSION;
+    header.instrument_size = sizeof(CachedInstrument);
+    header.participant_size = sizeof(CachedParticipant);
+    header.instrument_count = (uint32_t)instruments.size();
+    header.participant_count = (uint32_t)participants.size();
+
+    // Written next to the target and renamed, so a reader never maps a half-written cache.
+    string temporary_path = path + ".tmp";
+    std::ofstream file(temporary_path, std::ios::binary);
+    file.write((const char *)&header, sizeof(header));
+    file.write((const char *)instruments.data(), instruments.size() * sizeof(CachedInstrument));
+    file.write((const char *)participants.data(), participants.size() * sizeof(CachedParticipant));
+    file.close();
+    if (!file)
+    {
+        unlink(temporary_path.c_str());
+        return false;
+    }
+    return rename(temporary_path.c_str(), path.c_str()) == 0;
+}
+
+bool ReferenceCache::open(const string &path)
+{
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0 || (size_t)file_stat.st_size < sizeof(ReferenceCacheHeader))
+    {
+        ::close(fd);
+        return false;
+    }
+
+    size = file_stat.st_size;
+    void *address = mmap(nullptr, size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    ::close(fd);
+    if (address == MAP_FAILED)
+    {
+        size = 0;
+        return false;
+    }
+
+    data = (const char *)address;
+    const ReferenceCacheHeader &cache_header = header();
+    if (memcmp(cache_header.magic, REFERENCE_CACHE_MAGIC, sizeof(cache_header.magic)) != 0 ||
+        cache_header.version != REFERENCE_CACHE_VERSION ||
+        cache_header.instrument_size != sizeof(CachedInstrument) ||
+        cache_header.participant_size != sizeof(CachedParticipant) ||
+        size != sizeof(ReferenceCacheHeader) + (size_t)cache_header.instrument_count * sizeof(CachedInstrument) +
+                    (size_t)cache_header.participant_count * sizeof(CachedParticipant))
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void ReferenceCache::close()
+{
+    if (data != nullptr)
+    {
+        munmap((void *)data, size);
+    }
+    data = nullptr;
+    size = 0;
+}
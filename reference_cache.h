@@ -0,0 +1,129 @@
+#ifndef REFERENCE_CACHE_H
+#define REFERENCE_CACHE_H
+
+#include <cstdint>
+#include <string>
+#include "instrument_table.h"
+#include "market_participants.h"
+using namespace std;
+
+// Binary snapshot of the reference data a capture builds up from its stock
+// directory, trading action, Reg SHO and market participant messages. It is
+// written at the end of one replay and mapped at the start of the next, so a
+// replay has its symbols before the first message: the file is a header followed
+// by fixed-size records that are read in place, with no parsing.
+//
+// The day's own messages still arrive and are checked against the cached
+// entries (see InstrumentTable::add_to_instrument_table), so a cache from a
+// previous day is safe to load.
+
+constexpr char REFERENCE_CACHE_MAGIC[8] = {'I', 'T', 'C', 'H', 'R', 'E', 'F', 'C'};
+constexpr uint32_t REFERENCE_CACHE_VERSION = 1;
+
+struct ReferenceCacheHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t instrument_size;
+    uint32_t participant_size;
+    uint32_t instrument_count;
+    uint32_t participant_count;
+    uint32_t reserved;
+};
+
+// One InstrumentTableEntry, sorted by stock_locate.
+struct CachedInstrument
+{
+    uint16_t stock_locate;
+    char stock[8];
+    char market_category;
+    char financial_status_indicator;
+    uint32_t round_lot_size;
+    uint32_t etp_leverage_factor;
+    uint8_t round_lots_only;
+    char issue_classification;
+    char issue_sub_type[2];
+    char authenticity;
+    char short_sale_threshold;
+    char ipo_flag;
+    char luld_reference_price_tier;
+    char etp_flag;
+    uint8_t inverse_indicator;
+    char trading_state;
+    char reason[4];
+    char reg_sho_action;
+    char retail_interest_flag;
+    char operational_halt_action;
+    char reserved[2];
+};
+
+static_assert(sizeof(CachedInstrument) == 40, "CachedInstrument is mapped from disk as is");
+
+// One market participant position, sorted by stock then MPID.
+struct CachedParticipant
+{
+    char mpid[4];
+    char stock[8];
+    uint8_t primary_market_maker;
+    char market_maker_mode;
+    char market_participant_state;
+    char reserved;
+};
+
+static_assert(sizeof(CachedParticipant) == 16, "CachedParticipant is mapped from disk as is");
+
+// Writes the tables to path. Returns false if the file cannot be written.
+bool write_reference_cache(const string &path, const InstrumentTable &i_table, const MarketParticipantTable &mp_table);
+
+// The reference data of a cached instrument. The trading state and Reg SHO
+// action it had when the cache was written are left out: they belong to that day.
+InstrumentTableEntry instrument_entry(const CachedInstrument &instrument);
+
+// Read-only mapping of a reference cache file.
+class ReferenceCache
+{
+public:
+    ReferenceCache() = default;
+    ReferenceCache(const ReferenceCache &) = delete;
+    ReferenceCache &operator=(const ReferenceCache &) = delete;
+
+    ~ReferenceCache()
+    {
+        close();
+    }
+
+    // Fails if the file does not exist or was written with a different layout.
+    bool open(const string &path);
+    void close();
+
+    const CachedInstrument *instruments() const
+    {
+        return (const CachedInstrument *)(data + sizeof(ReferenceCacheHeader));
+    }
+
+    size_t instrument_count() const
+    {
+        return header().instrument_count;
+    }
+
+    const CachedParticipant *participants() const
+    {
+        return (const CachedParticipant *)(data + sizeof(ReferenceCacheHeader) + instrument_count() * sizeof(CachedInstrument));
+    }
+
+    size_t participant_count() const
+    {
+        return header().participant_count;
+    }
+
+private:
+    const char *data = nullptr;
+    size_t size = 0;
+
+    const ReferenceCacheHeader &header() const
+    {
+        return *(const ReferenceCacheHeader *)data;
+    }
+};
+
+#endif // REFERENCE_CACHE_H
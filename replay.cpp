@@ -0,0 +1,433 @@
+#include <iostream>
+#include "replay.h"
+#include "feed_reader.h"
+
+void print_replay_counters(const ReplayCounters &counters, std::ostream &os)
+{
+    os << "Parsed: " << std::dec << counters.frames << " messages (" << counters.bytes << " bytes)" << std::endl;
+    os << "Filtered: " << counters.filtered_frames
+       << " | Skipped: " << counters.skipped_frames
+       << " | Malformed: " << counters.malformed_frames
+       << " | Truncated: " << counters.truncated_frames
+       << " | Read errors: " << counters.read_errors
+       << " | Book errors: " << counters.book_errors
+       << " | Reference errors: " << counters.reference_errors << std::endl;
+    os << "Halts: " << counters.halts
+       << " | Re-openings: " << counters.reopenings
+       << " | Re-opening crosses: " << counters.reopening_crosses
+       << " | Suppressed publications: " << counters.suppressed_publications << std::endl;
+
+    for (int type = 0; type < 256; type++)
+    {
+        if (counters.skipped_by_type[type] > 0)
+        {
+            os << "  Skipped type '" << (char)type << "': " << counters.skipped_by_type[type] << std::endl;
+        }
+    }
+    for (int type = 0; type < 256; type++)
+    {
+        if (counters.book_errors_by_type[type] > 0)
+        {
+            os << "  Book errors on type '" << (char)type << "': " << counters.book_errors_by_type[type] << std::endl;
+        }
+    }
+    for (size_t result = 1; result < ORDER_BOOK_RESULT_COUNT; result++)
+    {
+        if (counters.book_errors_by_result[result] > 0)
+        {
+            os << "  " << order_book_result_name((OrderBookResult)result) << ": " << counters.book_errors_by_result[result] << std::endl;
+        }
+    }
+}
+
+static bool changes_resting_orders(MessageType message_type)
+{
+    return message_type == MessageType::ADD_ORDER_MESSAGE ||
+           message_type == MessageType::DELETE_CANCEL_MESSAGE ||
+           message_type == MessageType::REPLACE_MESSAGE ||
+           message_type == MessageType::ORDER_EXECUTED_MESSAGE ||
+           message_type == MessageType::ORDER_EXECUTED_PRICE_MESSAGE;
+}
+
+static uint16_t lifecycle_flags(const SymbolState &state)
+{
+    return ((state.flags & SYMBOL_SHORT_SALE_RESTRICTED) ? LIFECYCLE_FLAG_SHORT_SALE_RESTRICTED : 0) |
+           ((state.flags & SYMBOL_REOPENING) ? LIFECYCLE_FLAG_REOPENING : 0);
+}
+
+bool Replay::run(const string &path)
+{
+    FeedReader reader;
+    if (!reader.open(path, read_mode))
+    {
+        return false;
+    }
+
+    const char *frame;
+    uint16_t frame_length;
+    FrameStatus status = FrameStatus::OK;
+
+    stopped_early = false;
+    while (true)
+    {
+        if (counters.frames >= window.max_messages)
+        {
+            stopped_early = true;
+            break;
+        }
+        if ((status = reader.next_frame(frame, frame_length)) != FrameStatus::OK)
+        {
+            break;
+        }
+        // The timestamp follows the type byte, locate and tracking number.
+        if (frame_length >= 11 && parse_timestamp(&frame[5]) > window.end_timestamp)
+        {
+            stopped_early = true;
+            break;
+        }
+
+        apply_frame(frame, frame_length);
+        if (book_validator != nullptr)
+        {
+            book_validator->on_frame(frame, frame_length, counters.frames, order_book);
+        }
+    }
+
+    if (status == FrameStatus::TRUNCATED)
+    {
+        counters.truncated_frames++;
+    }
+    else if (status == FrameStatus::READ_ERROR)
+    {
+        counters.read_errors++;
+    }
+    return true;
+}
+
+void Replay::load_reference_cache(const ReferenceCache &cache)
+{
+    for (size_t i = 0; i < cache.instrument_count(); i++)
+    {
+        const CachedInstrument &instrument = cache.instruments()[i];
+        InstrumentTableEntry entry = instrument_entry(instrument);
+        i_table.add_cached_entry(instrument.stock_locate, entry);
+        symbol_filter.on_stock(entry.stock, instrument.stock_locate);
+        if (consolidated_bbo != nullptr)
+        {
+            consolidated_bbo->on_stock_directory(venue, instrument.stock_locate, entry.stock);
+        }
+    }
+
+    for (size_t i = 0; i < cache.participant_count(); i++)
+    {
+        const CachedParticipant &participant = cache.participants()[i];
+        MarketParticipantFlags flags = {
+            .primary_market_maker = participant.primary_market_maker != 0,
+            .market_maker_mode = participant.market_maker_mode,
+            .market_participant_state = participant.market_participant_state};
+        mp_table.set_position(string(participant.mpid, 4), string(participant.stock, 8), flags);
+    }
+}
+
+void Replay::apply_frame(const char *frame, uint16_t frame_length)
+{
+    counters.frames++;
+    counters.bytes += frame_length + 2;
+    if (frame_length == 0)
+    {
+        counters.malformed_frames++;
+        return;
+    }
+
+    if (symbol_filter.enabled() && !symbol_filter.accepts_frame(frame, frame_length))
+    {
+        counters.filtered_frames++;
+        return;
+    }
+
+    // Unknown types are skipped by their frame length so the rest of the feed is still replayed.
+    MessageType message_type = get_message_type(frame[0]);
+    if (message_type == MessageType::UNKNOWN_MESSAGE)
+    {
+        counters.skipped_frames++;
+        counters.skipped_by_type[(uint8_t)frame[0]]++;
+        return;
+    }
+
+    const char *body = &frame[1];
+    uint16_t length = frame_length - 1;
+    if (length != expected_message_length(frame[0]))
+    {
+        counters.malformed_frames++;
+        return;
+    }
+
+    uint64_t timestamp = parse_timestamp(&body[4]);
+    event_clock.advance(timestamp);
+    if (delta_publisher != nullptr && timestamp >= window.start_timestamp)
+    {
+        delta_publisher->advance(order_book, timestamp);
+    }
+    if (matching_simulator != nullptr)
+    {
+        matching_simulator->advance(timestamp, order_book, i_table);
+    }
+
+    OrderBookResult result = OrderBookResult::OK;
+    bool reference_ok = true;
+    uint64_t match_number = 0;
+    uint32_t trade_shares = 0;
+
+    if (message_type == MessageType::SYSTEM_EVENT_MESSAGE)
+    {
+        // System events do not touch the book or the reference data.
+    }
+    else if (message_type == MessageType::STOCK_DIRECTORY_MESSAGE)
+    {
+        StockDirectoryMessage message = parse_stock_directory_message(body);
+        reference_ok = i_table.add_to_instrument_table(message);
+        symbol_filter.on_stock_directory(message);
+        if (consolidated_bbo != nullptr && reference_ok)
+        {
+            consolidated_bbo->on_stock_directory(venue, message.header.stock_locate, string(message.stock, 8));
+        }
+    }
+    else if (message_type == MessageType::STOCK_TRADING_ACTION_MESSAGE)
+    {
+        StockTradingActionMessage message = parse_stock_trading_action_message(body);
+        reference_ok = i_table.add_stock_trading_action_message(message);
+        if (reference_ok)
+        {
+            apply_trading_action(message.header.stock_locate, message.trading_state);
+        }
+    }
+    else if (message_type == MessageType::REG_SHO_RESTRICTION)
+    {
+        RegSHORestriction message = parse_reg_sho_restriction(body);
+        reference_ok = i_table.add_reg_sho_restriction(message);
+        if (reference_ok)
+        {
+            order_book.set_reg_sho_action(message.header.stock_locate, message.reg_sho_action);
+        }
+    }
+    else if (message_type == MessageType::MARKET_PARTICIPANT_POSITION)
+    {
+        MarketParticipantPosition message = parse_market_participant_position(body);
+        mp_table.add_market_participant_position(message);
+    }
+    else if (message_type == MessageType::ADD_ORDER_MESSAGE)
+    {
+        AddOrderMessage message = parse_add_order_message(body, length);
+        result = order_book.add_order(message);
+        if (lifecycle_tracker != nullptr)
+        {
+            lifecycle_tracker->on_add(message.order_reference_number, message.header.stock_locate, message.buy_sell_indicator, message.shares, timestamp,
+                                      lifecycle_flags(order_book.symbol_state(message.header.stock_locate)));
+        }
+    }
+    else if (message_type == MessageType::DELETE_CANCEL_MESSAGE)
+    {
+        DeleteCancelMessage message = parse_delete_cancel_message(body, length);
+        result = order_book.delete_cancel_order(message);
+        if (lifecycle_tracker != nullptr)
+        {
+            if (message.delete_cancel_indicator == 'D')
+            {
+                lifecycle_tracker->on_delete(message.order_reference_number, timestamp);
+            }
+            else
+            {
+                lifecycle_tracker->on_cancel(message.order_reference_number, message.cancelled_shares, timestamp);
+            }
+        }
+    }
+    else if (message_type == MessageType::REPLACE_MESSAGE)
+    {
+        ReplaceOrderMessage message = parse_replace_order_message(body);
+        result = order_book.relpace_order(message);
+        if (lifecycle_tracker != nullptr)
+        {
+            lifecycle_tracker->on_replace(message.original_order_reference_number, message.new_order_reference_number, message.shares);
+        }
+    }
+    else if (message_type == MessageType::ORDER_EXECUTED_MESSAGE)
+    {
+        OrderExecutedMessage message = parse_order_executed_message(body);
+        result = order_book.execute_order(message);
+        if (lifecycle_tracker != nullptr)
+        {
+            lifecycle_tracker->on_execute(message.order_reference_number, message.executed_shares, timestamp);
+        }
+        match_number = message.match_number;
+        trade_shares = message.executed_shares;
+    }
+    else if (message_type == MessageType::ORDER_EXECUTED_PRICE_MESSAGE)
+    {
+        OrderExecutedPriceMessage message = parse_order_executed_price_message(body);
+        result = order_book.execute_order_price(message);
+        if (lifecycle_tracker != nullptr)
+        {
+            lifecycle_tracker->on_execute(message.order_reference_number, message.executed_shares, timestamp);
+        }
+        if (message.printable)
+        {
+            match_number = message.match_number;
+            trade_shares = message.executed_shares;
+        }
+    }
+    else if (message_type == MessageType::TRADE_CROSS_MESSAGE)
+    {
+        TradeCrossMessage message = parse_trade_cross_message(body);
+        result = order_book.execute_cross_trade(message);
+        match_number = message.match_number;
+        trade_shares = (uint32_t)message.shares;
+        if (message.cross_type == 'H' && order_book.end_reopening(message.header.stock_locate))
+        {
+            counters.reopening_crosses++;
+        }
+    }
+    else if (message_type == MessageType::TRADE_NON_CROSS_MESSAGE)
+    {
+        TradeNonCrossMessage message = parse_trade_non_cross_message(body);
+        result = order_book.execute_non_cross_trade(message);
+        match_number = message.match_number;
+        trade_shares = message.shares;
+    }
+    else if (message_type == MessageType::BROKEN_TRADE_MESSAGE)
+    {
+        BrokenTradeMessage message = parse_broken_trade_message(body);
+        result = order_book.break_trade(message);
+    }
+    else if (message_type == MessageType::RPII_MESSAGE)
+    {
+        RPIIMessage message = parse_rpii_message(body);
+        reference_ok = i_table.add_rpii_message(message);
+    }
+    else if (message_type == MessageType::OPERATIONAL_HALT_MESSAGE)
+    {
+        OperationalHaltMessage message = parse_operational_halt_message(body);
+        reference_ok = i_table.add_operational_halt_message(message);
+    }
+    else if (message_type == MessageType::NOII_MESSAGE)
+    {
+        NOIIMessage message = parse_noii_message(body);
+        auction_table.add_noii_message(message);
+    }
+    else if (message_type == MessageType::LULD_AUCTION_COLLAR)
+    {
+        LULDAuctionCollarMessage message = parse_luld_auction_collar_message(body);
+        auction_table.add_luld_auction_collar_message(message);
+    }
+    else if (message_type == MessageType::IPO_QUOTING_PERIOD)
+    {
+        IPOQuotingPeriodMessage message = parse_ipo_quoting_period_message(body);
+        auction_table.add_ipo_quoting_period_message(message);
+    }
+    else if (message_type == MessageType::MWCB_DECLINE_MESSAGE)
+    {
+        MWCBDeclineMessage message = parse_mwcb_decline_message(body);
+        auction_table.add_mwcb_decline_message(message);
+    }
+    else if (message_type == MessageType::MWCB_STATUS_MESSAGE)
+    {
+        MWCBStatusMessage message = parse_mwcb_status_message(body);
+        auction_table.add_mwcb_status_message(message);
+    }
+
+    // Re-openings without a halt cross end at the first trade.
+    if (trade_shares > 0 && message_type != MessageType::TRADE_CROSS_MESSAGE)
+    {
+        order_book.end_reopening(parse_uint16_t(body));
+    }
+
+    if (result != OrderBookResult::OK)
+    {
+        counters.book_errors++;
+        counters.book_errors_by_type[(uint8_t)frame[0]]++;
+        counters.book_errors_by_result[(size_t)result]++;
+    }
+    if (!reference_ok)
+    {
+        counters.reference_errors++;
+    }
+    if (matching_simulator != nullptr)
+    {
+        matching_simulator->on_frame_applied(timestamp, order_book);
+    }
+
+    if (timestamp < window.start_timestamp)
+    {
+        return;
+    }
+
+    if (activity_statistics != nullptr)
+    {
+        activity_statistics->record(frame[0], parse_uint16_t(body), timestamp, trade_shares);
+    }
+
+    if (book_publisher == nullptr && shm_book_writer == nullptr && consolidated_bbo == nullptr)
+    {
+        return;
+    }
+
+    // Halted books keep changing as orders are cancelled, but top of book is only
+    // published again once the stock trades; the trading action itself is
+    // published so readers see the state change, and so that the consolidated
+    // quote drops this venue while it is halted.
+    uint16_t stock_locate = parse_uint16_t(body);
+    bool publish_book = (changes_resting_orders(message_type) && !(order_book.symbol_state(stock_locate).flags & SYMBOL_HALTED)) ||
+                        message_type == MessageType::STOCK_TRADING_ACTION_MESSAGE;
+    if (changes_resting_orders(message_type) && !publish_book)
+    {
+        counters.suppressed_publications++;
+    }
+
+    if (book_publisher != nullptr && publish_book)
+    {
+        book_publisher->publish(order_book, stock_locate, timestamp);
+    }
+
+    if (consolidated_bbo != nullptr && publish_book)
+    {
+        consolidated_bbo->publish(venue, order_book, stock_locate, timestamp);
+    }
+
+    if (shm_book_writer != nullptr)
+    {
+        publish_shared_memory(publish_book, body, match_number, trade_shares);
+    }
+}
+
+void Replay::apply_trading_action(uint16_t stock_locate, char trading_state)
+{
+    uint8_t previous = order_book.set_trading_state(stock_locate, trading_state);
+    uint8_t current = order_book.symbol_state(stock_locate).flags;
+    if ((current & SYMBOL_HALTED) && !(previous & SYMBOL_HALTED))
+    {
+        counters.halts++;
+    }
+    if ((previous & (SYMBOL_HALTED | SYMBOL_QUOTATION_ONLY)) && !(current & (SYMBOL_HALTED | SYMBOL_QUOTATION_ONLY)))
+    {
+        counters.reopenings++;
+    }
+}
+
+void Replay::publish_shared_memory(bool publish_book, const char *body, uint64_t match_number, uint32_t trade_shares)
+{
+    Header header = parse_header(body);
+    if (publish_book)
+    {
+        shm_book_writer->publish_book(order_book, header.stock_locate, header.timestamp);
+    }
+
+    const ExecutedOrder *trade = (trade_shares > 0) ? order_book.find_trade(match_number) : nullptr;
+    if (trade != nullptr)
+    {
+        LastTrade last_trade = {
+            .timestamp = header.timestamp,
+            .match_number = match_number,
+            .price = trade->price,
+            .shares = trade_shares};
+        shm_book_writer->publish_trade(header.stock_locate, last_trade);
+    }
+}
@@ -0,0 +1,114 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <iostream>
+#include "helper.h"
+#include "instrument_table.h"
+#include "market_participants.h"
+#include "order_book.h"
+#include "auction_state.h"
+#include "symbol_filter.h"
+#include "book_publisher.h"
+#include "shm_book_writer.h"
+#include "event_clock.h"
+#include "book_validator.h"
+#include "activity_statistics.h"
+#include "lifecycle_tracker.h"
+#include "delta_publisher.h"
+#include "matching_simulator.h"
+#include "feed_reader.h"
+#include "reference_cache.h"
+#include "consolidated_bbo.h"
+#include "venue.h"
+using namespace std;
+
+struct ReplayCounters
+{
+    uint64_t frames;
+    uint64_t bytes;
+    uint64_t filtered_frames;
+    uint64_t skipped_frames;
+    uint64_t malformed_frames;
+    uint64_t truncated_frames;
+    // Replays cut short by a failed read or corrupt compressed input.
+    uint64_t read_errors;
+    uint64_t book_errors;
+    // Reference data messages for an unknown stock_locate or one registered to another symbol.
+    uint64_t reference_errors;
+    // Trading actions that halted or paused a trading stock.
+    uint64_t halts;
+    // Trading actions that resumed a halted or quotation-only stock.
+    uint64_t reopenings;
+    uint64_t reopening_crosses;
+    // Top of book updates not published because the stock was halted.
+    uint64_t suppressed_publications;
+    uint64_t skipped_by_type[256];
+    uint64_t book_errors_by_type[256];
+    uint64_t book_errors_by_result[ORDER_BOOK_RESULT_COUNT];
+};
+
+void print_replay_counters(const ReplayCounters &counters, std::ostream &os = std::cout);
+
+// Part of a capture to replay. Messages before start_timestamp still build the
+// book but are not recorded by the statistics or published; the replay stops at
+// the first message after end_timestamp, or once max_messages frames were read.
+struct ReplayWindow
+{
+    uint64_t start_timestamp = 0;
+    uint64_t end_timestamp = UINT64_MAX;
+    uint64_t max_messages = UINT64_MAX;
+};
+
+// All the state built from one capture. Every Replay is independent, so several
+// can run side by side on different threads.
+class Replay
+{
+public:
+    InstrumentTable i_table;
+    MarketParticipantTable mp_table;
+    OrderBook order_book;
+    AuctionStateTable auction_table;
+    SymbolFilter symbol_filter;
+    EventClock event_clock;
+    // When set, the top of book of every stock touched by a message is published here.
+    BookPublisher *book_publisher = nullptr;
+    // When set, top of book and last trade are also published to shared memory for other processes.
+    ShmBookWriter *shm_book_writer = nullptr;
+    // When set, checks the book as run replays the capture.
+    BookValidator *book_validator = nullptr;
+    // When set, per-stock message counts and rates are collected here.
+    ActivityStatistics *activity_statistics = nullptr;
+    // When set, every order is followed from add to its last fill or cancel.
+    LifecycleTracker *lifecycle_tracker = nullptr;
+    // When set, every price level change is published as a coalesced market-by-price delta.
+    DeltaPublisher *delta_publisher = nullptr;
+    // When set, this venue's top of book feeds a cross-venue best bid and offer.
+    ConsolidatedBbo *consolidated_bbo = nullptr;
+    // When set, simulated orders are entered into the book and filled by the replayed executions.
+    MatchingSimulator *matching_simulator = nullptr;
+    // The exchange the capture comes from; stock_locates are only unique within it.
+    Venue venue = Venue::NASDAQ;
+    ReplayCounters counters = {};
+    ReadMode read_mode = ReadMode::BUFFERED;
+    ReplayWindow window;
+    // Set when run stopped at the end of the window rather than the end of the capture.
+    bool stopped_early = false;
+
+    // Replays the capture at path to the end of the window. Returns false if it
+    // could not be opened; a read that fails part way is counted in read_errors.
+    bool run(const string &path);
+
+    // Preloads the reference data of a cache written by an earlier replay. The
+    // day's trading states and Reg SHO actions come from the capture. Call before run.
+    void load_reference_cache(const ReferenceCache &cache);
+
+    // Decodes one frame (message type byte followed by the body) and applies it.
+    void apply_frame(const char *frame, uint16_t frame_length);
+
+private:
+    // Updates the stock's SymbolState and counts halts and re-openings.
+    void apply_trading_action(uint16_t stock_locate, char trading_state);
+    void publish_shared_memory(bool publish_book, const char *body, uint64_t match_number, uint32_t trade_shares);
+};
+
+#endif // REPLAY_H
@@ -0,0 +1,102 @@
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <type_traits>
+
+// Single-writer sequence lock around a trivially copyable value. The writer never
+// waits; a reader copies the value and retries if the sequence number moved (or
+// was odd, i.e. a write was in flight) while it was copying. The value is stored
+// as relaxed atomic words so concurrent copies are not a data race.
+template <typename T>
+class SeqLock
+{
+    static_assert(std::is_trivially_copyable<T>::value, "SeqLock values are copied word by word");
+
+public:
+    SeqLock()
+    {
+        T empty = {};
+        store_words(empty);
+    }
+
+    // Writer side. Only one thread may call store for a given SeqLock.
+    void store(const T &value)
+    {
+        uint64_t current = sequence.load(std::memory_order_relaxed);
+        sequence.store(current + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        store_words(value);
+        sequence.store(current + 2, std::memory_order_release);
+    }
+
+    // Writer side: the writer can read back its own last value without retrying.
+    T peek() const
+    {
+        T value;
+        load_words(value);
+        return value;
+    }
+
+    // One attempt, never spins. Returns false if a write overlapped the copy.
+    bool try_load(T &value) const
+    {
+        uint64_t before = sequence.load(std::memory_order_acquire);
+        if (before & 1)
+        {
+            return false;
+        }
+        load_words(value);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return sequence.load(std::memory_order_relaxed) == before;
+    }
+
+    void load(T &value) const
+    {
+        while (!try_load(value))
+        {
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#else
+            std::this_thread::yield();
+#endif
+        }
+    }
+
+    // Even numbers are stable versions; it changes on every store.
+    uint64_t version() const
+    {
+        return sequence.load(std::memory_order_acquire);
+    }
+
+private:
+    static constexpr size_t WORDS = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    alignas(64) std::atomic<uint64_t> sequence{0};
+    std::atomic<uint64_t> words[WORDS];
+
+    void store_words(const T &value)
+    {
+        uint64_t buffer[WORDS] = {};
+        memcpy(buffer, &value, sizeof(T));
+        for (size_t i = 0; i < WORDS; i++)
+        {
+            words[i].store(buffer[i], std::memory_order_relaxed);
+        }
+    }
+
+    void load_words(T &value) const
+    {
+        uint64_t buffer[WORDS];
+        for (size_t i = 0; i < WORDS; i++)
+        {
+            buffer[i] = words[i].load(std::memory_order_relaxed);
+        }
+        memcpy(&value, buffer, sizeof(T));
+    }
+};
+
+#endif // SEQLOCK_H
@@ -0,0 +1,148 @@
+#ifndef SHM_BOOK_H
+#define SHM_BOOK_H
+
+#include <cstdint>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "book_snapshot.h"
+#include "seqlock.h"
+
+// Layout of the shared-memory book segment, shared by the feed handler that
+// writes it and by consumer processes. The segment is a ShmBookHeader followed
+// by one SeqLock<ShmBookEntry> per stock_locate, indexed directly by locate.
+// Consumers only need this header; it does not depend on the book builder.
+
+constexpr uint64_t SHM_BOOK_MAGIC = 0x4b4f4f4248435449ull; // "ITCHBOOK"
+constexpr uint32_t SHM_BOOK_VERSION = 2;
+
+struct LastTrade
+{
+    uint64_t timestamp;
+    uint64_t match_number;
+    Price price;
+    uint32_t shares;
+};
+
+struct ShmBookEntry
+{
+    BookSnapshot book;
+    LastTrade last_trade;
+};
+
+struct alignas(64) ShmBookHeader
+{
+    uint64_t magic;
+    uint32_t version;
+    uint32_t stock_locates;
+    uint32_t depth;
+    uint32_t entry_size;
+};
+
+inline size_t shm_book_segment_size(size_t stock_locates)
+{
+    return sizeof(ShmBookHeader) + stock_locates * sizeof(SeqLock<ShmBookEntry>);
+}
+
+// Read-only view of a segment created by ShmBookWriter. Reads never block the writer.
+class ShmBookReader
+{
+public:
+    ~ShmBookReader()
+    {
+        close();
+    }
+
+    // Fails if the segment does not exist or was written with a different layout.
+    bool open(const std::string &name)
+    {
+        close();
+        int fd = shm_open(name.c_str(), O_RDONLY, 0);
+        if (fd < 0)
+        {
+            return false;
+        }
+
+        struct stat segment_stat;
+        if (fstat(fd, &segment_stat) != 0 || (size_t)segment_stat.st_size < sizeof(ShmBookHeader))
+        {
+            ::close(fd);
+            return false;
+        }
+
+        size = segment_stat.st_size;
+        void *address = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (address == MAP_FAILED)
+        {
+            return false;
+        }
+
+        segment = (const char *)address;
+        const ShmBookHeader *header = (const ShmBookHeader *)segment;
+        if (__atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) != SHM_BOOK_MAGIC || header->version != SHM_BOOK_VERSION ||
+            header->depth != SNAPSHOT_DEPTH || header->entry_size != sizeof(SeqLock<ShmBookEntry>) ||
+            size < shm_book_segment_size(header->stock_locates))
+        {
+            close();
+            return false;
+        }
+
+        stock_locates = header->stock_locates;
+        entries = (const SeqLock<ShmBookEntry> *)(segment + sizeof(ShmBookHeader));
+        return true;
+    }
+
+    void close()
+    {
+        if (segment != nullptr)
+        {
+            munmap((void *)segment, size);
+        }
+        segment = nullptr;
+        entries = nullptr;
+        stock_locates = 0;
+    }
+
+    // Single attempt; false if the writer was updating this stock at the same moment.
+    bool try_read(uint16_t stock_locate, ShmBookEntry &entry) const
+    {
+        return stock_locate < stock_locates && entries[stock_locate].try_load(entry);
+    }
+
+    void read(uint16_t stock_locate, ShmBookEntry &entry) const
+    {
+        if (stock_locate < stock_locates)
+        {
+            entries[stock_locate].load(entry);
+        }
+    }
+
+    uint64_t version(uint16_t stock_locate) const
+    {
+        return (stock_locate < stock_locates) ? entries[stock_locate].version() : 0;
+    }
+
+    // Entries in the segment; valid stock_locates are below this.
+    size_t stock_locate_count() const
+    {
+        return stock_locates;
+    }
+
+    // True once a new writer has replaced the segment under the same name; it is
+    // no longer updated and open() must be called again to follow the new one.
+    bool replaced() const
+    {
+        return segment != nullptr && __atomic_load_n(&((const ShmBookHeader *)segment)->magic, __ATOMIC_ACQUIRE) != SHM_BOOK_MAGIC;
+    }
+
+private:
+    const char *segment = nullptr;
+    size_t size = 0;
+    const SeqLock<ShmBookEntry> *entries = nullptr;
+    uint32_t stock_locates = 0;
+};
+
+#endif // SHM_BOOK_H
@@ -0,0 +1,131 @@
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include "helper.h"
+#include "shm_book.h"
+using namespace std;
+
+// Consumer of the shared-memory book that parser -P publishes, run as a separate
+// process next to it. It polls the version of every stock_locate, reads the ones
+// that moved and checks each copy: levels best first, non-empty, and timestamps
+// that never go back for a stock. At the end it prints the last top of book and
+// trade of every stock it saw.
+//
+//     shm_book_reader [-d seconds] [-w seconds] segment_name
+//
+// -d is how long to read for (default 10), -w how long to wait for the segment
+// to appear (default 10). It stops early if a new writer replaces the segment.
+// The exit status is 1 if any inconsistent copy was read.
+
+int main(int argc, char *argv[])
+{
+    uint64_t read_seconds = 10;
+    uint64_t wait_seconds = 10;
+    bool valid = true;
+    int option;
+    while ((option = getopt(argc, argv, "d:w:")) != -1)
+    {
+        switch (option)
+        {
+        case 'd':
+            valid = valid && parse_unsigned(optarg, 86400, read_seconds);
+            break;
+        case 'w':
+            valid = valid && parse_unsigned(optarg, 86400, wait_seconds);
+            break;
+        default:
+            valid = false;
+            break;
+        }
+    }
+    if (!valid || optind != argc - 1)
+    {
+        cerr << "Usage: " << argv[0] << " [-d seconds] [-w seconds] segment_name" << endl;
+        return 1;
+    }
+    string name = argv[optind];
+
+    ShmBookReader reader;
+    auto wait_until = std::chrono::steady_clock::now() + std::chrono::seconds(wait_seconds);
+    while (!reader.open(name))
+    {
+        if (std::chrono::steady_clock::now() >= wait_until)
+        {
+            cerr << "Unable to open shared memory segment: " << name << endl;
+            return 1;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    size_t stock_locates = reader.stock_locate_count();
+    vector<uint64_t> versions(stock_locates, 0);
+    vector<ShmBookEntry> entries(stock_locates, ShmBookEntry{});
+    uint64_t updates = 0;
+    uint64_t inconsistent = 0;
+
+    auto read_until = std::chrono::steady_clock::now() + std::chrono::seconds(read_seconds);
+    bool replaced = false;
+    while (std::chrono::steady_clock::now() < read_until && !(replaced = reader.replaced()))
+    {
+        for (size_t stock_locate = 1; stock_locate < stock_locates; stock_locate++)
+        {
+            uint64_t version = reader.version((uint16_t)stock_locate);
+            if (version == versions[stock_locate])
+            {
+                continue;
+            }
+            ShmBookEntry entry;
+            reader.read((uint16_t)stock_locate, entry);
+            const BookSnapshot &book = entry.book;
+            if (!well_formed(book) || book.timestamp < entries[stock_locate].book.timestamp ||
+                entry.last_trade.timestamp < entries[stock_locate].last_trade.timestamp)
+            {
+                inconsistent++;
+            }
+            versions[stock_locate] = version;
+            entries[stock_locate] = entry;
+            updates++;
+        }
+    }
+
+    cout << "Stock Locate,Time,Bid,Bid Volume,Ask,Ask Volume,Last Trade Price,Last Trade Shares" << endl;
+    for (size_t stock_locate = 1; stock_locate < stock_locates; stock_locate++)
+    {
+        if (versions[stock_locate] == 0)
+        {
+            continue;
+        }
+        const ShmBookEntry &entry = entries[stock_locate];
+        const BookSnapshot &book = entry.book;
+        cout << stock_locate << "," << format_timestamp(book.timestamp) << ",";
+        if (book.bid_levels > 0)
+        {
+            cout << book.bids[0].price << "," << book.bids[0].volume;
+        }
+        else
+        {
+            cout << ",";
+        }
+        cout << ",";
+        if (book.ask_levels > 0)
+        {
+            cout << book.asks[0].price << "," << book.asks[0].volume;
+        }
+        else
+        {
+            cout << ",";
+        }
+        cout << "," << entry.last_trade.price << "," << entry.last_trade.shares << endl;
+    }
+    cout << "Updates read: " << updates << " | Inconsistent: " << inconsistent;
+    if (replaced)
+    {
+        cout << " | Stopped: the segment was replaced";
+    }
+    cout << endl;
+    return (inconsistent > 0) ? 1 : 0;
+}
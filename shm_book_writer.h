@@ -0,0 +1,139 @@
+#ifndef SHM_BOOK_WRITER_H
+#define SHM_BOOK_WRITER_H
+
+#include <new>
+#include "order_book.h"
+#include "shm_book.h"
+using namespace std;
+
+// Feed handler side of the shared-memory book. Creates (or replaces) the named
+// POSIX shared-memory segment and publishes top of book and last trade for every
+// stock_locate into it. There must be a single writer per segment.
+class ShmBookWriter
+{
+public:
+    ~ShmBookWriter()
+    {
+        close();
+    }
+
+    // Returns false if the segment cannot be created or mapped.
+    bool create(const string &segment_name, size_t locates = UINT16_MAX + 1)
+    {
+        close();
+        // Readers may still map the previous segment; truncating it would SIGBUS them.
+        // It is retired and unlinked instead, and they keep their mapping until they reopen.
+        retire(segment_name);
+        shm_unlink(segment_name.c_str());
+        int fd = shm_open(segment_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+        if (fd < 0)
+        {
+            return false;
+        }
+
+        size = shm_book_segment_size(locates);
+        if (ftruncate(fd, size) != 0)
+        {
+            ::close(fd);
+            shm_unlink(segment_name.c_str());
+            return false;
+        }
+
+        void *address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (address == MAP_FAILED)
+        {
+            shm_unlink(segment_name.c_str());
+            return false;
+        }
+
+        segment = (char *)address;
+        name = segment_name;
+        stock_locates = locates;
+        entries = new (segment + sizeof(ShmBookHeader)) SeqLock<ShmBookEntry>[stock_locates];
+
+        // The header is filled in last so readers never accept a half-built segment.
+        ShmBookHeader *header = (ShmBookHeader *)segment;
+        header->version = SHM_BOOK_VERSION;
+        header->stock_locates = (uint32_t)stock_locates;
+        header->depth = SNAPSHOT_DEPTH;
+        header->entry_size = sizeof(SeqLock<ShmBookEntry>);
+        __atomic_store_n(&header->magic, SHM_BOOK_MAGIC, __ATOMIC_RELEASE);
+        return true;
+    }
+
+    // Unmaps the segment; with unlink it is also removed for consumers.
+    void close(bool unlink = false)
+    {
+        if (segment != nullptr)
+        {
+            munmap(segment, size);
+            if (unlink)
+            {
+                shm_unlink(name.c_str());
+            }
+        }
+        segment = nullptr;
+        entries = nullptr;
+        stock_locates = 0;
+    }
+
+    void publish_book(const OrderBook &book, uint16_t stock_locate, uint64_t timestamp)
+    {
+        if (stock_locate >= stock_locates)
+        {
+            return;
+        }
+
+        ShmBookEntry entry = entries[stock_locate].peek();
+        BookSnapshot snapshot = book.get_snapshot(stock_locate, timestamp);
+        if (same_book(entry.book, snapshot))
+        {
+            return;
+        }
+        entry.book = snapshot;
+        entries[stock_locate].store(entry);
+    }
+
+    void publish_trade(uint16_t stock_locate, const LastTrade &trade)
+    {
+        if (stock_locate >= stock_locates)
+        {
+            return;
+        }
+
+        ShmBookEntry entry = entries[stock_locate].peek();
+        entry.last_trade = trade;
+        entries[stock_locate].store(entry);
+    }
+
+private:
+    string name;
+
+    // Clears the magic of an existing segment, so that its readers see ShmBookReader::replaced.
+    static void retire(const string &segment_name)
+    {
+        int fd = shm_open(segment_name.c_str(), O_RDWR, 0);
+        if (fd < 0)
+        {
+            return;
+        }
+        struct stat segment_stat;
+        if (fstat(fd, &segment_stat) == 0 && (size_t)segment_stat.st_size >= sizeof(ShmBookHeader))
+        {
+            void *address = mmap(nullptr, sizeof(ShmBookHeader), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (address != MAP_FAILED)
+            {
+                __atomic_store_n(&((ShmBookHeader *)address)->magic, 0, __ATOMIC_RELEASE);
+                munmap(address, sizeof(ShmBookHeader));
+            }
+        }
+        ::close(fd);
+    }
+    char *segment = nullptr;
+    size_t size = 0;
+    SeqLock<ShmBookEntry> *entries = nullptr;
+    size_t stock_locates = 0;
+};
+
+#endif // SHM_BOOK_WRITER_H
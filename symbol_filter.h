@@ -0,0 +1,60 @@
+#ifndef SYMBOL_FILTER_H
+#define SYMBOL_FILTER_H
+
+#include <bitset>
+#include <string>
+#include <unordered_set>
+#include "helper.h"
+#include "instrument_table.h"
+using namespace std;
+
+// Whitelist of symbols to replay. Symbols are resolved to stock_locates as their
+// stock directory messages arrive, after which frames for every other stock_locate
+// can be dropped by peeking at the locate field, without decoding the message.
+class SymbolFilter
+{
+private:
+    unordered_set<string> symbols;
+    bitset<UINT16_MAX + 1> tracked_locates;
+
+public:
+    // Symbols are padded to the 8 character ITCH stock field.
+    void add_symbol(const string &symbol)
+    {
+        string padded = symbol.substr(0, 8);
+        padded.resize(8, ' ');
+        symbols.insert(padded);
+    }
+
+    bool enabled() const
+    {
+        return !symbols.empty();
+    }
+
+    void on_stock_directory(const StockDirectoryMessage &message)
+    {
+        on_stock(string(message.stock, 8), message.header.stock_locate);
+    }
+
+    // Resolves a stock known from a stock directory message or a reference cache. A
+    // stock_locate reassigned to another symbol stops being tracked.
+    void on_stock(const string &stock, uint16_t stock_locate)
+    {
+        tracked_locates.set(stock_locate, symbols.count(stock) > 0);
+    }
+
+    // Frames are kept if they carry no stock (locate 0) or a tracked one. Stock
+    // directory messages always go through since they are what resolves the filter.
+    bool accepts_frame(const char *frame, uint16_t frame_length) const
+    {
+        if (frame_length < 3 || frame[0] == 'R')
+        {
+            return true;
+        }
+
+        uint16_t stock_locate = parse_uint16_t(&frame[1]);
+        return stock_locate == 0 || tracked_locates.test(stock_locate);
+    }
+};
+
+#endif // SYMBOL_FILTER_H
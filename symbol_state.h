@@ -0,0 +1,32 @@
+#ifndef SYMBOL_STATE_H
+#define SYMBOL_STATE_H
+
+#include <cstdint>
+
+// SymbolState flags.
+// Halted or paused: the book is kept up to date but top of book is not published.
+constexpr uint8_t SYMBOL_HALTED = 1 << 0;
+// Quotation-only period ahead of a re-opening (or IPO) auction.
+constexpr uint8_t SYMBOL_QUOTATION_ONLY = 1 << 1;
+// Between the end of a halt and the re-opening cross, or the first trade if
+// trading resumed without one.
+constexpr uint8_t SYMBOL_REOPENING = 1 << 2;
+// Reg SHO short sale price test in effect.
+constexpr uint8_t SYMBOL_SHORT_SALE_RESTRICTED = 1 << 3;
+
+// Trading state of one stock_locate as last reported by the trading action
+// and Reg SHO messages. OrderBook keeps these in a flat array indexed like its
+// books, so the per-message paths read the state without a map lookup.
+struct SymbolState
+{
+    // 'H' halted, 'P' paused, 'Q' quotation only, 'T' trading, 0 before the first trading action.
+    char trading_state;
+    // '0' no price test, '1' restriction triggered today, '2' restriction carried over, 0 before any message.
+    char reg_sho_action;
+    uint8_t flags;
+    uint8_t reserved;
+};
+
+static_assert(sizeof(SymbolState) == 4, "SymbolState is meant to stay in a word");
+
+#endif // SYMBOL_STATE_H
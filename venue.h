@@ -0,0 +1,51 @@
+#ifndef VENUE_H
+#define VENUE_H
+
+#include <cctype>
+#include <cstdint>
+#include <string>
+using namespace std;
+
+// Exchanges whose TotalView-ITCH 5.0 feeds this decoder replays. BX and PSX
+// publish the same framing, message types and layouts as NASDAQ, so one set of
+// decoders (decode.h) and one OrderBook serve all three; what differs is the
+// venue's identity, and its stock_locates, which each venue assigns on its own.
+enum class Venue : uint8_t
+{
+    NASDAQ,
+    BX,
+    PSX
+};
+
+constexpr size_t VENUE_COUNT = 3;
+
+constexpr const char *VENUE_NAMES[VENUE_COUNT] = {"NASDAQ", "BX", "PSX"};
+
+inline const char *venue_name(Venue venue)
+{
+    return VENUE_NAMES[(size_t)venue];
+}
+
+// The venue named in a capture's file name, e.g. 12302019.BX_ITCH50 or
+// 12302019.PSX_ITCH50. Captures that name no other venue are taken as NASDAQ.
+inline Venue venue_from_path(const string &path)
+{
+    string name = path.substr(path.find_last_of('/') + 1);
+    for (size_t venue = 1; venue < VENUE_COUNT; venue++)
+    {
+        string token = VENUE_NAMES[venue];
+        for (size_t at = name.find(token); at != string::npos; at = name.find(token, at + 1))
+        {
+            // The name must stand alone, so that e.g. "BOX" is not read as BX.
+            bool starts = at == 0 || !isalpha((unsigned char)name[at - 1]);
+            bool ends = at + token.size() == name.size() || !isalpha((unsigned char)name[at + token.size()]);
+            if (starts && ends)
+            {
+                return (Venue)venue;
+            }
+        }
+    }
+    return Venue::NASDAQ;
+}
+
+#endif // VENUE_H